@@ -22,38 +22,146 @@ typedef enum bg_statusTM_t bg_statusTM_t;
  * (estado y numero de conexion)
  */
 typedef struct bg_infoTM_t bg_infoTM_t;
-//-----------------------------------Declaracion de tipos de variable, variables con alcance local end-------------
 
+/**
+ * @brief Este tipo de variable es un buffer circular de bytes de un solo productor y un solo consumidor
+ * (SPSC) sin bloqueos.
+ * 
+ * Su proposito es desacoplar la interrupcion de UART (productor) del hilo principal (consumidor), de manera
+ * que la interrupcion solo copie los bytes recibidos una vez y el analisis de respuestas y URC se haga fuera
+ * de la interrupcion.
+ */
+typedef struct bg_ring_t bg_ring_t;
 
-//-----------------------------------Declaracion funciones static----------------------
 /**
- * @brief Esta funcion realiza la configuracion del modulo de comunicacion.
- * (Formatos de respuesta y configurar URC que se contemplan).
+ * @brief Tipo de dato para crear un puntero a funcion que parsea los campos de un URC.
  * 
- * @return bg_err_t 
+ * @param fields Es la cadena (terminada en nulo) con los campos del URC que siguen al prefijo.
+ * @param infoUrc Es la variable en donde se guarda la informacion parseada.
  */
-static bg_err_t bg_config_module(void);
+typedef void (*bg_urcParser_t)(uint8_t *fields, urcInfoData_t *infoUrc);
+
+/**
+ * @brief Este tipo de variable es un renglon de la tabla de URC soportados (prefijo, tipo de URC y
+ * funcion que parsea sus campos).
+ * 
+ * Su proposito es que agregar un URC solo requiera agregar un renglon a la tabla.
+ */
+typedef struct bg_urcEntry_t bg_urcEntry_t;
+
+/**
+ * @brief Este tipo de variable enlista los estados del motor de comandos AT.
+ * 
+ */
+typedef enum
+{
+	BG_CMD_IDLE,		//No hay comando en curso
+	BG_CMD_WAIT_ANSW,	//Se envio el comando y se espera un codigo de resultado final (o el prompt '>')
+	BG_CMD_WAIT_SEND	//Se envio el payload despues del prompt y se espera SEND OK, SEND FAIL o ERROR
+}bg_cmdState_t;
+
+/**
+ * @brief Este tipo de variable es un comando AT encolado en el motor de comandos (comando formateado,
+ * payload opcional, timeout y callback de fin de comando).
+ */
+typedef struct bg_cmd_t bg_cmd_t;
 
 /**
- * @brief Limpia el contador de segundos de la libreria y activa el conteo.
+ * @brief Este tipo de variable es el contexto del callback con el que bg_send() espera a su comando.
  * 
  */
-static void bg_start_timeout(void);
+typedef struct bg_cmdWait_t bg_cmdWait_t;
+
+/**
+ * @brief Este tipo de variable enlista los comandos que encola el arranque de red. Se entrega como contexto
+ * del callback de fin de comando (en AT+QIOPEN se le suma el indice del socket).
+ */
+typedef enum
+{
+	BG_BRINGUP_REQ_AT,			//"AT" de la etapa de encendido (modulo ya encendido o listo despues del arranque)
+	BG_BRINGUP_REQ_ATD1,		//AT&D1 (solo con MAIN_DTR)
+	BG_BRINGUP_REQ_QRFTESTMODE,	//AT+QRFTESTMODE=0 (ultimo comando del encendido)
+	BG_BRINGUP_REQ_CPIN,		//AT+CPIN? (respaldo de +CPIN: READY)
+	BG_BRINGUP_REQ_CEREG,		//AT+CEREG? (respaldo de +CEREG)
+	BG_BRINGUP_REQ_COPS,		//AT+COPS=4 con la operadora de la configuracion
+	BG_BRINGUP_REQ_QICSGP,		//AT+QICSGP (configuracion del contexto PDP)
+	BG_BRINGUP_REQ_QIACT,		//AT+QIACT=<contextID>
+	BG_BRINGUP_REQ_QIACT_QUERY,	//AT+QIACT? (confirma el contexto si AT+QIACT respondio error)
+	BG_BRINGUP_REQ_QIOPEN		//AT+QIOPEN del socket 0 (el socket i usa BG_BRINGUP_REQ_QIOPEN + i)
+}bg_bringupReq_t;
+
+/**
+ * @brief Este tipo de variable enlista las subetapas de la etapa de encendido del arranque de red (los mismos
+ * pasos de bg_init_module(), cada uno avanza con un comando encolado o un instante limite).
+ */
+typedef enum
+{
+	BG_BRINGUP_PWR_PROBE,		//"AT" para saber si el modulo ya esta encendido
+	BG_BRINGUP_PWR_PULSE,		//pulso de PWRKEY (o RESET_N) en curso
+	BG_BRINGUP_PWR_BOOT,		//espera de RDY/APP RDY o del pin STATUS
+	BG_BRINGUP_PWR_READY,		//"AT" despues del arranque
+	BG_BRINGUP_PWR_CONFIG,		//perfil de configuracion
+	BG_BRINGUP_PWR_SETUP		//AT&D1 y AT+QRFTESTMODE=0
+}bg_bringupPwr_t;
+
+/**
+ * @brief Este tipo de variable contiene el estado del arranque de red no bloqueante (etapas iniciadas y
+ * terminadas, comandos en la cola, sockets abiertos y metricas de tiempo).
+ */
+typedef struct bg_bringup_t bg_bringup_t;
 
 /**
- * @brief Detiene el conteo y devuelve el ultimo valor que se conto.
+ * @brief Este tipo de variable es un buffer del grupo de envio agrupado (datos pendientes de un socket y su
+ * estado: libre, llenandose o en un AT+QISEND en curso).
+ */
+typedef struct bg_txBuff_t bg_txBuff_t;
+
+/**
+ * @brief Este tipo de variable contiene la configuracion, el buffer en llenado y las estadisticas del envio
+ * agrupado de un socket.
+ */
+typedef struct bg_txCoalesce_t bg_txCoalesce_t;
+
+/**
+ * @brief Este tipo de variable contiene el avance de un envio grande (segmentos en la cola, bytes confirmados
+ * y estado de la pausa por bytes sin ACK).
+ */
+typedef struct bg_largeSend_t bg_largeSend_t;
+
+/**
+ * @brief Este tipo de variable contiene el avance de un lote de datagramas UDP.
+ */
+typedef struct bg_udpBatch_t bg_udpBatch_t;
+
+/**
+ * @brief Este tipo de variable contiene una apertura asincrona en curso (callback y limite de espera de +QIOPEN).
+ */
+typedef struct bg_openPend_t bg_openPend_t;
+
+/**
+ * @brief Este tipo de variable indica si un connectID pertenece al pool de conexiones y si esta en uso.
+ */
+typedef struct bg_poolEntry_t bg_poolEntry_t;
+//-----------------------------------Declaracion de tipos de variable, variables con alcance local end-------------
+
+
+//-----------------------------------Declaracion funciones static----------------------
+/**
+ * @brief Esta funcion realiza la configuracion del modulo de comunicacion.
+ * (Formatos de respuesta y configurar URC que se contemplan).
  * 
- * @return uint32_t es el ultimo valor que se conto.
+ * @return bg_err_t 
  */
-static uint32_t bg_stop_timeout(void);
+static bg_err_t bg_config_module(void);
 
 /**
  * @brief Funcion que detecta si ocurrio un URC
  * 
  * @param buff Puntero a funcion que contiene el mensaje donde se dertecta el URC.
  * @param len Tamaño en bytes del mensaje recibido en buff.
+ * @return uint8_t Devuelve el numero de URC detectados.
  */
-static void bg_detect_urc(uint8_t *buff, uint16_t len);
+static uint8_t bg_detect_urc(uint8_t *buff, uint16_t len);
 
 /**
  * @brief Obtiene la instancia del Singleton del estado de modo transparente.
@@ -76,982 +184,4757 @@ static bg_infoTM_t bg_getter_transparentMode(void);
  * @param value Es el valor que se va a establecer o escribir en la instancia.
  */
 static void bg_setter_transparentMode(bg_infoTM_t value);
-//-----------------------------------Declaracion funciones static end-----------------
 
+/**
+ * @brief Programa los intentos de regreso a modo transparente despues de una salida (evento de salida de TM).
+ * 
+ * @param tries Numero de intentos (se limita a los de la politica).
+ */
+static void bg_tm_reentry_schedule(uint8_t tries);
 
-//-----------------------------------Definicion de tipos de variable, variables con alcance local-----------------
-enum bg_statusTM_t
-{
-	BG_TM_INACTIVE,
-	BG_TM_ACTIVE
-};
+/**
+ * @brief Escribe bytes en el buffer circular. Solo debe llamarse desde el productor (interrupcion de UART).
+ * 
+ * NOTE: Si no hay espacio suficiente se escriben los bytes que quepan y el resto se contabiliza como perdido.
+ * 
+ * @param ring Es el buffer circular.
+ * @param data Es el puntero a los bytes a escribir.
+ * @param len Es el numero de bytes a escribir.
+ * @return uint16_t Devuelve el numero de bytes escritos.
+ */
+static uint16_t bg_ring_write(bg_ring_t *ring, const uint8_t *data, uint16_t len);
 
-struct bg_infoTM_t
-{
-	bg_statusTM_t statusTM;
-	bg_noCarrierTM_t statusNoCarrier;
-	uint8_t connectID;
-};
-//-----------------------------------Definicion de tipos de variable, variables con alcance local end-------------
+/**
+ * @brief Obtiene el tramo contiguo de bytes pendientes de leer sin copiarlos.
+ * Solo debe llamarse desde el consumidor (hilo principal).
+ * 
+ * @param ring Es el buffer circular.
+ * @param data Puntero en donde se devuelve la direccion del primer byte pendiente dentro del buffer circular.
+ * @return uint16_t Devuelve el numero de bytes contiguos que se pueden leer desde data.
+ */
+static uint16_t bg_ring_span(bg_ring_t *ring, uint8_t **data);
 
+/**
+ * @brief Libera bytes ya leidos del buffer circular para que el productor pueda reutilizarlos.
+ * 
+ * @param ring Es el buffer circular.
+ * @param len Es el numero de bytes que se liberan.
+ */
+static void bg_ring_release(bg_ring_t *ring, uint16_t len);
 
-//-----------------------------------Flags--------------------------------------------
-#define flg_uart_bg flag.f0 //1: se recibio un mensjae por interrupcion de uart.
-#define flg_tout_bg flag.f1 //1: bandera que indica que el tiempo de espera de respuesta de comando fue superado
-#define NOMBRE_USR_4 flag.f3 
-#define NOMBRE_USR_5 flag.f4
-#define NOMBRE_USR_6 flag.f5
-#define NOMBRE_USR_7 flag.f6
-#define NOMBRE_USR_8 flag.f7
-static flags_t flag = {0}; //banderas de 1 bit
-//-----------------------------------Flags end----------------------------------------
+/**
+ * @brief Consume todos los bytes pendientes del buffer circular de recepcion.
+ * Entrega los datos de modo transparente, arma la respuesta de comandos AT y detecta URC.
+ * 
+ * NOTE: Se llama desde los ciclos de espera de la libreria y desde bg_handle_urc(void), nunca desde la interrupcion.
+ */
+static void bg_rx_process(void);
 
+/**
+ * @brief Cede el CPU mientras se espera una respuesta del modulo. Usa el hook waitEvent del BSP
+ * (maximo BG_WAIT_EVENT_MAX_MS o lo que falte para deadline) y si no existe ejecuta un nop.
+ * 
+ * @param deadline Instante limite (ms de bg_get_tick_ms()) de la espera en curso.
+ */
+static void bg_wait_event(uint32_t deadline);
 
-//-----------------------------------Buffers------------------------------------------
-//uBg es el buffer el cual se reciben las respuestas del modulo de comunicaciones.
-//uBgUrc es el buffer el cual se utiliza para hacer el tratado de URC.
-static uartBuff_t uBg = {.buff = {'\0'}, .len = 0},\
-		   uBgUrc = {.buff = {'\0'}, .len = 0};
-//-----------------------------------Buffers end--------------------------------------
+/**
+ * @brief Procesa un tramo contiguo de bytes recibidos tomado del buffer circular.
+ * Cada byte se analiza una sola vez: en modo transparente se entrega al usuario y en modo comando
+ * alimenta al tokenizador de lineas.
+ * 
+ * @param data Puntero al tramo de bytes dentro del buffer circular.
+ * @param len Numero de bytes del tramo.
+ */
+static void bg_rx_handle(uint8_t *data, uint16_t len);
 
+/**
+ * @brief Entrega datos de modo transparente al usuario y vigila la llegada de "NO CARRIER".
+ * 
+ * @param data Puntero al tramo de bytes dentro del buffer circular.
+ * @param len Numero de bytes del tramo.
+ * @return uint16_t Devuelve el numero de bytes consumidos. Si se detecto "NO CARRIER" los bytes
+ * restantes pertenecen al modo comando.
+ */
+static uint16_t bg_rx_tm_data(uint8_t *data, uint16_t len);
 
-//-----------------------------------Counters-----------------------------------------
-static volatile uint32_t count_interrp;		//cuenta 1000 interrupciones para generar 1s
-static volatile uint32_t count_sec_bg;		//contador de segundos para espera de timeout
-static volatile uint32_t count_sec_bg_ok;	//contador de segundos para timeout en respuesta esperada del modulo bg
-//-----------------------------------Counters end-------------------------------------
+/**
+ * @brief Copia los datos binarios que siguen a "+QIURC: \"recv\",<connectID>,<len>" (direct push mode). Al
+ * completar los <len> bytes se encolan en bgPushQueue (connectID en el tipo del registro) y bg_handle_urc(void)
+ * los entrega, el renglon del URC no pasa por la cola de URC.
+ * 
+ * @param data Puntero al tramo de bytes dentro del buffer circular.
+ * @param len Numero de bytes del tramo.
+ * @return uint16_t Devuelve el numero de bytes consumidos, los restantes pertenecen al modo comando.
+ */
+static uint16_t bg_rx_push_data(uint8_t *data, uint16_t len);
 
+/**
+ * @brief Si la linea es "+QIURC: \"recv\",<connectID>,<len>" prepara la captura de los <len> bytes siguientes.
+ * 
+ * @param line Puntero al inicio de la linea dentro de bgResp.
+ * @param textLen Numero de bytes de la linea sin "\r\n".
+ * @return uint8_t 1 si es un URC de direct push mode, 0 en caso contrario.
+ */
+static uint8_t bg_rx_push_start(uint8_t *line, uint16_t textLen);
 
-//----------------------------------Queue--------------------------------------------
-Cola_t bgUrcQueue; //cola para eventos URC detectados
-//----------------------------------Queue end----------------------------------------
+/**
+ * @brief Si la linea es "+QIOPEN: <connectID>,<err>" de una apertura de bg_open_sckt_async() guarda el resultado
+ * en bgOpenPend, bg_open_poll() lo aplica sin pasar por la cola de URC.
+ * 
+ * @param line Puntero al inicio de la linea dentro de bgResp.
+ * @param textLen Numero de bytes de la linea sin "\r\n".
+ * @return uint8_t 1 si la linea era el resultado de una apertura asincrona, 0 en caso contrario.
+ */
+static uint8_t bg_rx_open_result(uint8_t *line, uint16_t textLen);
 
+/**
+ * @brief Entrega al usuario (como URC "recv") el siguiente bloque de direct push mode encolado.
+ * 
+ * @return uint8_t 1 si se entrego un bloque, 0 si la cola de direct push mode estaba vacia.
+ */
+static uint8_t bg_recv_push(void);
 
-//-----------------------------------BSP----------------------------------------------
-//puntero a funcion para funcion de transmision por UART en puerto BG
-static uartFun_t bgUartTx;
-//puntero a funcion para escribir estado en pin de salida gpio (BG_PWRKEY_PIN, BG_VBAT_PIN, BG_RESET_PIN, BG_PON_TRIG_PIN) 
-static gpioWriteFun_t bgGpioWrite;
-//puntero a funcion para generar delays en ms
-static delayFun_t bgDelay;
-//puntero a funcion para reiniciar al MCU
-static resetFun_t bgResetMCU;
+/**
+ * @brief Callback de fin del AT+QISEND de un datagrama de bg_transmit_udp_batch().
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el lote (bg_udpBatch_t).
+ */
+static void bg_udp_batch_callback(bg_cmdResult_t result, void *ctx);
 
-void bg_set_bsp(bg_bspFun_t bspFun)
-{
-	bgUartTx = bspFun.uartTx;
-	bgGpioWrite = bspFun.gpioWrite;
-	bgDelay = bspFun.msDelay;
-	bgResetMCU = bspFun.resetMCU;
-	flg_tout_bg = 1;
-	flg_uart_bg = 0;
-}
-//-----------------------------------BSP end-----------------------------------
+/**
+ * @brief Callback de fin del comando AT+QIOPEN de bg_open_sckt_async(). Solo termina la apertura si el modulo
+ * no acepto el comando, en caso contrario se espera el URC +QIOPEN.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el connectID.
+ */
+static void bg_open_async_callback(bg_cmdResult_t result, void *ctx);
 
+/**
+ * @brief Termina una apertura asincrona y llama a su callback.
+ * 
+ * @param connectID numero de conexion.
+ * @param err resultado de la apertura.
+ */
+static void bg_open_done(uint8_t connectID, bg_err_t err);
 
-//---------------------------Callbacks MCU para LIB----------------------------
-void bg_callback_ms(void)
-{
-	count_interrp = (count_interrp + 1)%1001;
+/**
+ * @brief Termina las aperturas asincronas cuyo +QIOPEN guardo bg_rx_open_result() y encola AT+QICLOSE para las
+ * que no lo recibieron despues de BG_OPEN_TIMEOUT. El socket sigue en OPENING (connectID ocupado) hasta que
+ * termina el cierre en bg_open_close_callback().
+ * Se llama desde bg_handle_urc(void) y bg_open_sckts().
+ */
+static void bg_open_poll(void);
 
-	if (!flg_tout_bg)
-			count_sec_bg = (count_sec_bg + count_interrp/1000)%MAX_SEC;
-}
+/**
+ * @brief Callback de fin del AT+QICLOSE de una apertura sin +QIOPEN. Deja el socket en INITIAL y termina la
+ * apertura con BG_ERR_OPEN_SCKT.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el connectID.
+ */
+static void bg_open_close_callback(bg_cmdResult_t result, void *ctx);
 
-void bg_uartCallback(uint8_t *buff, uint16_t nBytes)
-{
-	uBg.len = uBgUrc.len = nBytes;
+/**
+ * @brief Callback de apertura de bg_open_sckts(), guarda el resultado.
+ * 
+ * @param connectID numero de conexion.
+ * @param err resultado de la apertura.
+ * @param ctx Es el bg_err_t donde se guarda el resultado.
+ */
+static void bg_open_wait_callback(uint8_t connectID, bg_err_t err, void *ctx);
 
-	memcpy(uBg.buff, buff, uBg.len);
-	memset(buff, '\0', sizeof(uBg.buff));
-	memcpy(uBgUrc.buff, uBg.buff, uBgUrc.len);
+/**
+ * @brief Formatea el AT+QIOPEN de un socket (con IP y puerto remoto, o como servicio local segun serviceType).
+ * Lo usan bg_open_sckt(), bg_open_sckt_async() y el arranque de red.
+ * 
+ * @param sckt Es el socket que se va a abrir.
+ * @return const uint8_t* Comando en un buffer static (se sobreescribe en la siguiente llamada) o NULL si
+ * serviceType no es valido o el comando no cabe en BG_CMD_MAX_LEN.
+ */
+static const uint8_t *bg_qiopen_cmd(const bgSckt_t *sckt);
 
-	bg_infoTM_t infoTM = bg_getter_transparentMode();
+/**
+ * @brief Cierra los sockets del pool sin uso que superaron BG_POOL_IDLE_MS o que el punto remoto cerro.
+ * Se llama desde bg_handle_urc(void). No bloquea: encola AT+QICLOSE con bg_send_async() y el cierre termina
+ * en bg_pool_close_callback().
+ */
+static void bg_pool_poll(void);
 
-	if(infoTM.statusTM == BG_TM_ACTIVE)
-	{
-		if(strstr(uBgUrc.buff, "NO CARRIER"))
-		{
-			bg_callback_closed_TM();
-			bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_SET,\
-				.connectID = infoTM.connectID};
-			bg_setter_transparentMode(valueTM);
-			LOG_BG(LE, "*NO CARRIER URC*\n");
+/**
+ * @brief Callback de fin del AT+QICLOSE encolado por bg_pool_poll(). Libera el connectID y lo saca del pool. Si
+ * el comando falla el socket sigue en el pool (sin reutilizarse) y bg_pool_poll() reintenta el cierre despues de
+ * BG_POOL_CLOSE_RETRY_MS.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el connectID.
+ */
+static void bg_pool_close_callback(bg_cmdResult_t result, void *ctx);
 
-			urcRawData_t tmExitNC = {.buff = "no carrier", .len = 10, .type = BG_URC_NO_CARRIER};
-			bg_queue_put(tmExitNC);
-		}
-		else
-			bg_callback_receive_TM(uBgUrc.buff, uBg.len);
+/**
+ * @brief Cierra el socket del pool que lleva mas tiempo sin uso para liberar su connectID.
+ * 
+ * @return uint8_t 1 si se cerro un socket, 0 si no habia ninguno sin uso.
+ */
+static uint8_t bg_pool_evict(void);
 
-		memset(uBgUrc.buff, '\0', sizeof(uBgUrc.buff));
-	}
+/**
+ * @brief Tokenizador incremental. Agrega un byte a la linea en curso y, si la linea se completa (o llega
+ * el prompt '>'), genera el token correspondiente.
+ * 
+ * @param chr Es el byte recibido.
+ */
+static void bg_rx_token_byte(uint8_t chr);
 
-	else
-	{
-		if(strstr(uBgUrc.buff, "NO CARRIER"))
-		{
-			bg_callback_closed_TM();
-			bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_SET,\
-				.connectID = infoTM.connectID};
-			bg_setter_transparentMode(valueTM);
-			LOG_BG(LE, "-NO CARRIER URC-\n");
+/**
+ * @brief Clasifica una linea completa de la respuesta del modulo (codigo de resultado final,
+ * respuesta intermedia o URC) y registra el token generado.
+ * 
+ * @param line Puntero al inicio de la linea dentro de bgResp.
+ * @param len Numero de bytes de la linea (incluye "\r\n").
+ */
+static void bg_rx_line(uint8_t *line, uint16_t len);
 
-			urcRawData_t tmExitNC = {.buff = "no carrier", .len = 10, .type = BG_URC_NO_CARRIER};
-			bg_queue_put(tmExitNC);
-		}
+/**
+ * @brief Agrega un byte al buffer de respuesta. Si el buffer se llena se descartan las lineas
+ * completas mas antiguas.
+ * 
+ * @param chr Es el byte a agregar.
+ */
+static void bg_resp_append(uint8_t chr);
 
-		bg_detect_urc(uBgUrc.buff, uBgUrc.len);
-	}	
+/**
+ * @brief Establece el prefijo de una linea que se espera recibir (BG_TOK_EXPECTED).
+ * 
+ * @param prefix Es el prefijo esperado. Con NULL se deja de esperar una linea.
+ */
+static void bg_rx_expect(const char *prefix);
 
-	LOG_BG(LD, "uBglen: %ld\n", nBytes);
-	flg_uart_bg = 1;
-}
+/**
+ * @brief Atiende la salida de modo transparente por "NO CARRIER".
+ */
+static void bg_no_carrier_event(void);
 
-void bg_mainRICallback(mainRiEdge_t edge)
-{
-	if(edge == MAIN_RI_EDGE_FALLING)
-	{
-		bg_infoTM_t infoTM = bg_getter_transparentMode();
-		
-		if(infoTM.statusTM == BG_TM_INACTIVE) return;
+/**
+ * @brief Indica si una linea "+<nombre>: ..." es la respuesta al comando AT en curso (y no un URC).
+ * 
+ * @param line Puntero al inicio de la linea.
+ * @param len Numero de bytes de la linea.
+ * @return uint8_t Devuelve 1 si la linea es respuesta del comando en curso y 0 en caso contrario.
+ */
+static uint8_t bg_rx_solicited(uint8_t *line, uint16_t len);
 
-		bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = infoTM.statusNoCarrier,\
-			.connectID = infoTM.connectID};
-		bg_setter_transparentMode(valueTM);
+/**
+ * @brief Busca en una sola pasada el prefijo mas largo de la tabla de URC con el que inicia una linea.
+ * 
+ * La tabla esta ordenada, por lo que el recorrido funciona como un arbol de prefijos (trie): cada
+ * caracter de la linea reduce el rango de renglones candidatos y ningun caracter se vuelve a revisar.
+ * 
+ * @param line Puntero al inicio de la linea.
+ * @param len Numero de bytes de la linea.
+ * @return int Devuelve el indice del renglon de bgUrcTbl que coincidio o -1 si la linea no es un URC.
+ */
+static int bg_match_urc(uint8_t *line, uint16_t len);
 
-		urcRawData_t tmExit = {.buff = "mainRI", .len = 7, .type = BG_URC_EXIT_TM};
-		bg_queue_put(tmExit);
-	}
+/**
+ * @brief Obtiene el renglon de la tabla de URC correspondiente a un tipo de URC.
+ * 
+ * @param type Es el tipo de URC.
+ * @return const bg_urcEntry_t* Devuelve el renglon o NULL si el tipo no esta en la tabla.
+ */
+static const bg_urcEntry_t *bg_urc_entry(bg_urcType_t type);
 
-	else if(edge == MAIN_RI_EDGE_RISING)
-	{
-		
-	}
-}
+/**
+ * @brief Parsea URC cuyo primer campo es el connectID ("recv", "closed").
+ * 
+ */
+static void bg_parse_urc_connectID(uint8_t *fields, urcInfoData_t *infoUrc);
 
-static void bg_detect_urc(uint8_t *buff, uint16_t len)
-{
-	uint8_t *urcStr[] = {"incoming", "recv", "closed", "incoming full", "pdpdeact"};
+/**
+ * @brief Parsea el URC "incoming" (connectID y serverID).
+ * 
+ */
+static void bg_parse_urc_incoming(uint8_t *fields, urcInfoData_t *infoUrc);
 
-	bg_urcType_t urc, urcType[] = {BG_URC_INCOMING, BG_URC_RECV, BG_URC_CLOSED,\
-		BG_URC_INCOMING_FULL, BG_URC_PDP_DEACT};
-	
-	for(int i = 0; i < sizeof(urcStr)/sizeof(urcStr[0]) ; i++)
-	{
-		if(strstr(buff, urcStr[i]))
-		{	
-			LOG_BG(LE, "URC MATCH [%d]\n", i);
+/**
+ * @brief Parsea el URC "pdpdeact" (contextID).
+ * 
+ */
+static void bg_parse_urc_contextID(uint8_t *fields, urcInfoData_t *infoUrc);
 
-			uint8_t *ptrParse = strstr(buff, urcStr[i]);
-			while(ptrParse != NULL)
-			{
-				urcRawData_t urcDetected = {.buff = '\0', .len = len, .type = urcType[i]};
-				strcpy(urcDetected.buff, ptrParse);
-				bg_callback_urcDetected(urcDetected);
-				ptrParse++;
-				ptrParse = strstr(ptrParse, urcStr[i]);
-			}
-		}
-	}
-	memset(uBgUrc.buff, '\0', sizeof(uBgUrc.buff));
-}
+/**
+ * @brief Parsea el URC +CEREG (estado de registro en result).
+ * 
+ */
+static void bg_parse_urc_cereg(uint8_t *fields, urcInfoData_t *infoUrc);
 
-void bg_handle_urc(void)
-{
-	if(bg_queue_is_empty()) 
-	{
-		LOG_BG(LD, "queue is empty\n");
+/**
+ * @brief Parsea el URC +QIOPEN (connectID y codigo de error en result).
+ * 
+ */
+static void bg_parse_urc_qiopen(uint8_t *fields, urcInfoData_t *infoUrc);
+
+/**
+ * @brief Parsea el URC +CPIN (result = 1 si la SIM esta lista).
+ * 
+ */
+static void bg_parse_urc_cpin(uint8_t *fields, urcInfoData_t *infoUrc);
+
+/**
+ * @brief Busca una cadena dentro de un bloque de memoria de tamaño conocido (puede contener bytes nulos).
+ * 
+ * @param buff Es el bloque de memoria en donde se busca.
+ * @param len Es el tamaño en bytes del bloque.
+ * @param str Es la cadena a buscar.
+ * @return uint8_t* Devuelve el puntero a la primera ocurrencia o NULL si no se encontro.
+ */
+static uint8_t *bg_memstr(uint8_t *buff, uint16_t len, const char *str);
+
+/**
+ * @brief Limpia el buffer de respuesta antes de una nueva transaccion con el modulo.
+ * Primero consume lo pendiente en el buffer circular para no perder URC que llegaron antes.
+ */
+static void bg_resp_reset(void);
+
+/**
+ * @brief Formatea un comando AT y lo agrega a la cola del motor de comandos.
+ * 
+ * @param timeout Tiempo de espera (ms) de cada fase del comando.
+ * @param enablePrint LE para imprimir el comando y su respuesta en el Log, LD para no imprimirlos.
+ * @param iov Segmentos que se transmiten al recibir el prompt '>' (NULL si el comando no tiene payload). Un solo
+ * segmento se copia al comando, varios deben seguir siendo validos hasta que termine el comando.
+ * @param iovCnt Numero de segmentos de iov.
+ * @param callback Funcion que recibe el resultado del comando.
+ * @param ctx Puntero de contexto para callback.
+ * @param fmt Formato del comando.
+ * @param args Parametros variables del formato.
+ * @return bg_err_t BG_OK si se encolo, BG_ERR_CMD_QUEUE_FULL o BG_ERR_CMD_FORMAT en caso contrario.
+ */
+static bg_err_t bg_cmd_submit(uint32_t timeout, uint8_t enablePrint, const bg_iovec_t *iov, uint8_t iovCnt,\
+	bg_cmdCallback_t callback, void *ctx, const char *fmt, va_list args);
+
+/**
+ * @brief Encola un comando AT y bloquea (llamando a bg_poll()) hasta que termina. Es la base de la API bloqueante.
+ * 
+ * @return bg_err_t BG_OK si llego un codigo de resultado final o el codigo de error correspondiente.
+ */
+static bg_err_t bg_cmd_run(uint32_t timeout, uint8_t enablePrint, const bg_iovec_t *iov, uint8_t iovCnt,\
+	const char *fmt, va_list args);
+
+/**
+ * @brief Version bloqueante de bg_send_data_async(), la usan las funciones de transmision de la libreria.
+ * 
+ * @return bg_err_t BG_OK si llego SEND OK, SEND FAIL o ERROR (se revisa en bgRxTokens) o el codigo de error correspondiente.
+ */
+static bg_err_t bg_send_data(uint32_t timeout, uint8_t enablePrint, const bg_iovec_t *iov, uint8_t iovCnt,\
+	const char *fmt, ...);
+
+/**
+ * @brief Envia al modulo el comando que esta al frente de la cola del motor de comandos.
+ * 
+ */
+static void bg_cmd_start(void);
+
+/**
+ * @brief Termina el comando en curso: lo saca de la cola, deja el motor libre y llama a su callback.
+ * 
+ * @param err Resultado del comando (BG_OK, BG_ERR_TIMEOUT_ANS o BG_ERR_MCU_TX_UART).
+ */
+static void bg_cmd_complete(bg_err_t err);
+
+/**
+ * @brief Callback interno de bg_cmd_run() que guarda el resultado del comando en un bg_cmdWait_t.
+ * 
+ */
+static void bg_cmd_wait_callback(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Decodifica el codigo de resultado final de error que genero el tokenizador.
+ * 
+ * @param tokens Mascara de tokens del comando (bgRxTokens).
+ * @return bg_err_t BG_ERR_CME, BG_ERR_CMS, BG_ERR_SEND_FAIL, BG_ERR_AT o BG_OK si no hay resultado de error.
+ */
+static bg_err_t bg_final_err(uint32_t tokens);
+
+/**
+ * @brief Indica si el nombre de un comando extendido ("+<nombre>") aparece en un comando AT seguido de
+ * '=', '?', ';' o fin de comando.
+ * 
+ * @param cmd Comando AT (terminado en nulo).
+ * @param name Nombre a buscar (ej. "+CEREG").
+ * @param nameLen Numero de bytes de name.
+ * @return uint8_t* Devuelve el puntero a la ocurrencia dentro de cmd o NULL si no aparece.
+ */
+static const uint8_t *bg_cmd_find_name(const uint8_t *cmd, const uint8_t *name, uint16_t nameLen);
+
+/**
+ * @brief Envia uno tras otro (por el motor de comandos) los comandos de un tramo del lote.
+ * 
+ * @param batch Primer comando del tramo.
+ * @param nCmds Numero de comandos del tramo.
+ * @return bg_err_t BG_OK o el primer error encontrado.
+ */
+static bg_err_t bg_batch_pipeline(bg_batchCmd_t *batch, uint8_t nCmds);
+
+/**
+ * @brief Callback del motor de comandos que guarda el resultado de un comando del lote.
+ * 
+ */
+static void bg_batch_callback(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Reparte las lineas "+<nombre>:" de la respuesta de una linea concatenada a los comandos del tramo.
+ * 
+ * @param batch Primer comando del tramo.
+ * @param nCmds Numero de comandos del tramo.
+ */
+static void bg_batch_split(bg_batchCmd_t *batch, uint8_t nCmds);
+
+/**
+ * @brief Busca una cadena dentro de otra sin distinguir mayusculas de minusculas.
+ * 
+ * @param str Cadena donde se busca (terminada en nulo).
+ * @param sub Cadena a buscar.
+ * @return uint8_t* Devuelve el puntero a la primera ocurrencia o NULL si no se encontro.
+ */
+static uint8_t *bg_strcasestr(uint8_t *str, const char *sub);
+
+/**
+ * @brief Prueba si el modulo contesta "AT" con OK (modulo encendido y en modo comando).
+ * 
+ * @param tries Numero de intentos, cada uno con timeout BG_TIMEOUT_QUICK.
+ * @return bg_err_t BG_OK si el modulo contesto o el codigo de error del ultimo intento.
+ */
+static bg_err_t bg_boot_probe(uint8_t tries);
+
+/**
+ * @brief Espera a que el modulo termine de arrancar despues de un pulso de PWRKEY o RESET: termina al llegar el
+ * URC RDY/APP RDY o, si existe el hook statusRead, cuando el pin STATUS indica encendido.
+ * 
+ * NOTE: El pin STATUS se activa antes de que el modulo acepte comandos, por eso despues se prueba con "AT".
+ * @param timeout Tiempo maximo de espera (ms).
+ * @return bg_err_t BG_OK si se detecto el arranque o BG_ERR_TIMEOUT_ANS_DESIRED.
+ */
+static bg_err_t bg_boot_wait_ready(uint32_t timeout);
+
+/**
+ * @brief Limpia el estado que el modulo pierde al reiniciarse o apagarse (configuracion de modo transparente,
+ * sockets, pool y contextos PDP).
+ */
+static void bg_module_state_reset(void);
+
+/**
+ * @brief Marca el inicio de una etapa del arranque de red y calcula su instante limite.
+ * 
+ * @param stage Etapa que inicia.
+ */
+static void bg_bringup_begin(bg_bringupStage_t stage);
+
+/**
+ * @brief Marca una etapa del arranque de red como terminada, guarda su duracion y llama a bg_bringup_callback().
+ * 
+ * @param stage Etapa que termino.
+ */
+static void bg_bringup_finish(bg_bringupStage_t stage);
+
+/**
+ * @brief Detiene el arranque de red por el fallo de una etapa.
+ * 
+ * @param stage Etapa que fallo.
+ * @param err Error de la etapa.
+ */
+static void bg_bringup_fail(bg_bringupStage_t stage, bg_err_t err);
+
+/**
+ * @brief Encola un comando del arranque de red con bg_send_async().
+ * 
+ * @param req Comando del arranque (bg_bringupReq_t, en AT+QIOPEN mas el indice del socket), se entrega como
+ * contexto al callback.
+ * @param timeout Tiempo de espera (ms) de la respuesta.
+ * @param fmt Es el formato del comando.
+ * @param ... Son los parametros variables del formato.
+ * @return bg_err_t BG_OK si se encolo o el error de bg_send_async().
+ */
+static bg_err_t bg_bringup_submit(uint8_t req, uint32_t timeout, const char *fmt, ...);
+
+/**
+ * @brief Avanza la etapa de encendido del arranque de red sin bloquear: encola "AT", genera el pulso de PWRKEY
+ * (o RESET_N) y espera RDY/STATUS con instantes limite revisados en cada bg_bringup_step().
+ * 
+ * NOTE: El perfil de configuracion (bg_apply_config) es el unico tramo sincrono, son comandos de respuesta
+ * inmediata (BG_TIMEOUT_QUICK).
+ */
+static void bg_bringup_power(void);
+
+/**
+ * @brief Inicia un pulso de encendido del arranque de red o, si ya se hicieron BG_POWER_ON_ATTEMPTS, hace fallar
+ * la etapa de encendido con BG_ERR_TIMEOUT_ANS_DESIRED (en lugar de reiniciar el MCU como bg_init_module()).
+ */
+static void bg_bringup_pulse(void);
+
+/**
+ * @brief Encola el AT+QIOPEN de un socket de la configuracion del arranque de red.
+ * 
+ * @param idx Indice del socket en cfg->sckt.
+ * @return bg_err_t BG_OK si se encolo o el error de bg_send_async().
+ */
+static bg_err_t bg_bringup_open(uint8_t idx);
+
+/**
+ * @brief Encola una consulta de respaldo (AT+CPIN?, AT+CEREG?) si no hay otra igual en la cola y ya paso
+ * BG_BRINGUP_POLL_MS desde la ultima.
+ * 
+ * @param req Consulta del arranque.
+ * @param cmd Comando de consulta.
+ */
+static void bg_bringup_poll(bg_bringupReq_t req, const char *cmd);
+
+/**
+ * @brief Callback de fin de comando de los comandos que encola el arranque de red.
+ * 
+ * @param result Resultado del comando.
+ * @param ctx Comando del arranque (bg_bringupReq_t).
+ */
+static void bg_bringup_cmd_callback(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Avanza el arranque de red con los URC +CPIN, +CEREG y +QIOPEN. Se llama en bg_handle_urc(void)
+ * despues de parsear cada URC.
+ * 
+ * @param infoUrc Informacion del URC parseado.
+ */
+static void bg_bringup_urc(const urcInfoData_t *infoUrc);
+
+/**
+ * @brief Registra en la tabla de sockets un AT+QIOPEN enviado (parametros del socket y estado OPENING).
+ * 
+ * @param sckt Es el socket que se esta abriendo.
+ */
+static void bg_sckt_opening(const bgSckt_t *sckt);
+
+/**
+ * @brief Cambia el estado de un socket de la tabla. BG_SCKT_STATE_INITIAL borra el renglon.
+ * 
+ * @param connectID Es el numero de conexion (rango 0-11).
+ * @param state Es el nuevo estado.
+ */
+static void bg_sckt_set_state(uint8_t connectID, bg_scktState_t state);
+
+/**
+ * @brief Actualiza la tabla de sockets con el resultado de una apertura (+QIOPEN: <connectID>,<err>).
+ * 
+ * @param connectID Es el numero de conexion.
+ * @param result Es el codigo <err> de +QIOPEN (0 si se abrio).
+ */
+static void bg_sckt_open_result(uint8_t connectID, uint16_t result);
+
+/**
+ * @brief Actualiza la tabla de sockets con un URC ya parseado (+QIOPEN, "closed", "incoming" y "pdpdeact").
+ * 
+ * @param infoUrc Es el URC parseado.
+ */
+static void bg_sckt_urc(const urcInfoData_t *infoUrc);
+
+/**
+ * @brief Parsea una linea "+QISTATE: ..." y actualiza el renglon de su connectID en la tabla de sockets.
+ * 
+ * @param line Es la linea de la respuesta que inicia con "+QISTATE: ".
+ * @return uint8_t connectID actualizado o BG_SCKT_NONE si la linea no se pudo parsear.
+ */
+static uint8_t bg_sckt_parse_qistate(uint8_t *line);
+
+/**
+ * @brief Parsea todas las lineas "+QIACT: <contextID>,<state>,<type>,<IP>" de una respuesta de AT+QIACT? y
+ * actualiza la tabla de contextos PDP. Los contextos que no aparecen quedan desactivados.
+ * 
+ * @param resp Es la respuesta de AT+QIACT? (terminada en nulo).
+ */
+static void bg_pdp_parse_qiact(uint8_t *resp);
+
+/**
+ * @brief Copia datos al buffer de envio agrupado de un socket y encola un AT+QISEND cada vez que se llega al umbral.
+ * 
+ * @param connectID Es el numero de conexion.
+ * @param iov Son los segmentos del mensaje.
+ * @param iovCnt Es el numero de segmentos.
+ * @return bg_err_t BG_OK_TRANSMIT o el error al obtener un buffer o encolar el envio.
+ */
+static bg_err_t bg_tx_coalesce_write(uint8_t connectID, const bg_iovec_t *iov, uint8_t iovCnt);
+
+/**
+ * @brief Encola el AT+QISEND del buffer en llenado de un socket (si tiene datos).
+ * 
+ * @param connectID Es el numero de conexion.
+ * @param counter Es la estadistica que se incrementa (umbral, plazo o explicito).
+ * @param block 1: espera lugar en la cola de comandos, 0: si la cola esta llena regresa y se reintenta despues.
+ * @return bg_err_t BG_OK, BG_ERR_CMD_QUEUE_FULL (solo con block = 0) o el error al encolar.
+ */
+static bg_err_t bg_tx_coalesce_flush(uint8_t connectID, uint32_t *counter, uint8_t block);
+
+/**
+ * @brief Envia los buffers de envio agrupado cuyo plazo ya se cumplio. No bloquea.
+ * 
+ */
+static void bg_tx_coalesce_poll(void);
+
+/**
+ * @brief Callback de fin de AT+QISEND de un buffer de envio agrupado, libera el buffer.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el buffer (bg_txBuff_t) que se envio.
+ */
+static void bg_tx_coalesce_callback(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Callback de fin del AT+QISEND de un segmento de un envio grande.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el envio grande (bg_largeSend_t).
+ */
+static void bg_large_send_callback(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Callback de fin de AT+QISEND=<connectID>,0 de un envio grande, pausa o reanuda el envio segun los bytes
+ * sin ACK.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el envio grande (bg_largeSend_t).
+ */
+static void bg_large_query_callback(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Envia AT+QIRD=<connectID>,<reqLen> y ubica los datos en la respuesta.
+ * 
+ * @param connectID numero de conexion.
+ * @param reqLen bytes pedidos, con 0 se consulta "+QIRD: <total>,<leidos>,<sin leer>".
+ * @param data puntero donde se guarda la posicion de los datos dentro de bgResp (valido hasta el siguiente comando).
+ * @param len variable donde se guarda el numero de bytes leidos o, si reqLen es 0, los bytes sin leer.
+ * @param from variable donde se guarda la direccion de origen en UDP SERVICE (puede ser NULL).
+ * @return bg_err_t BG_OK o el error del comando.
+ */
+static bg_err_t bg_qird(uint8_t connectID, uint16_t reqLen, uint8_t **data, uint32_t *len, bg_udpAddr_t *from);
+
+/**
+ * @brief Sink de bg_receive_stream() usado para el URC "recv": copia cada bloque en el urcInfoData_t
+ * y llama bg_urc_parsed_callback().
+ * 
+ * @param connectID numero de conexion.
+ * @param data bytes del bloque.
+ * @param len numero de bytes del bloque.
+ * @param ctx urcInfoData_t del URC.
+ */
+static void bg_recv_urc_sink(uint8_t connectID, const uint8_t *data, uint16_t len, void *ctx);
+//-----------------------------------Declaracion funciones static end-----------------
+
+
+//-----------------------------------Definicion de tipos de variable, variables con alcance local-----------------
+enum bg_statusTM_t
+{
+	BG_TM_INACTIVE,
+	BG_TM_ACTIVE
+};
+
+struct bg_infoTM_t
+{
+	bg_statusTM_t statusTM;
+	bg_noCarrierTM_t statusNoCarrier;
+	uint8_t connectID;
+};
+
+struct bg_ring_t
+{
+	uint8_t buff[SIZE_BG_RING_BUFF];
+	volatile uint16_t head;	//indice de escritura (libre), solo lo modifica el productor
+	volatile uint16_t tail;	//indice de lectura (libre), solo lo modifica el consumidor
+	volatile uint32_t lost;	//bytes descartados por falta de espacio (solo lo incrementa el productor, nunca se reinicia)
+};
+
+struct bg_urcEntry_t
+{
+	const char *prefix;	//inicio de la linea que identifica al URC
+	bg_urcType_t type;	//tipo de URC que se encola
+	bg_urcParser_t parser;	//funcion que parsea los campos que siguen al prefijo (NULL si no tiene campos)
+	uint8_t deferred;	//1: es el resultado diferido de un comando (llega despues del OK), nunca es su respuesta directa
+};
+
+struct bg_cmd_t
+{
+	uint8_t cmd[BG_CMD_MAX_LEN];	//comando formateado terminado en "\r\n"
+	uint16_t cmdLen;
+	bg_iovec_t seg;					//copia del payload cuando es de un solo segmento
+	const bg_iovec_t *iov;			//segmentos que se envian al recibir el prompt '>' (NULL si no hay)
+	uint8_t iovCnt;
+	uint16_t payloadLen;			//suma de los segmentos
+	uint32_t timeout;				//tiempo de espera (ms) de cada fase del comando
+	uint8_t enablePrint;
+	bg_cmdCallback_t callback;
+	void *ctx;
+};
+
+struct bg_cmdWait_t
+{
+	volatile uint8_t done;
+	bg_err_t err;
+};
+
+struct bg_bringup_t
+{
+	const bg_bringupCfg_t *cfg;
+	bg_bringupStats_t stats;
+	uint32_t t0;							//instante (ms) de bg_bringup_start()
+	uint32_t deadline[BG_BRINGUP_DONE];		//instante limite de cada etapa iniciada
+	uint8_t beganMask;						//etapas iniciadas (bit = etapa)
+	uint8_t doneMask;						//etapas terminadas (bit = etapa)
+	uint16_t reqMask;						//comandos del arranque en la cola (bit = bg_bringupReq_t, sin AT+QIOPEN)
+	uint16_t sentMask;						//comandos que ya se encolaron al menos una vez (bit = bg_bringupReq_t)
+	uint8_t pending;						//numero de comandos del arranque en la cola (incluye AT+QIOPEN)
+	uint16_t scktSent;						//sockets con AT+QIOPEN encolado (bit = indice en cfg->sckt)
+	uint16_t scktOpen;						//sockets que recibieron +QIOPEN: <connectID>,0
+	uint32_t nextPoll;						//instante de la siguiente consulta de respaldo
+	uint8_t pdpQuery;						//1: AT+QIACT respondio error y se confirma con AT+QIACT?
+	uint8_t pwrState;						//subetapa del encendido (bg_bringupPwr_t)
+	uint8_t pwrAttempts;					//pulsos de encendido enviados
+	uint8_t pwrTries;						//"AT" que faltan en BG_BRINGUP_PWR_PROBE o BG_BRINGUP_PWR_READY
+	bgPin_t pwrPin;							//pin del pulso en curso (BG_PWRKEY_PIN o BG_RESET_PIN)
+	uint32_t pwrDeadline;					//fin del pulso o limite de espera del arranque
+};
+
+struct bg_txBuff_t
+{
+	uint8_t data[BG_QISEND_MAX_LEN];
+	uint16_t len;
+	uint8_t connectID;
+	uint8_t state;		//BG_TX_BUFF_FREE, BG_TX_BUFF_FILLING o BG_TX_BUFF_SENDING
+	uint32_t flushAt;	//instante limite de envio (plazo desde la primera escritura)
+};
+
+struct bg_txCoalesce_t
+{
+	uint16_t threshold;			//0: envio agrupado deshabilitado
+	uint32_t flushMs;
+	bg_txBuff_t *buff;			//buffer en llenado (NULL si no hay datos pendientes)
+	bg_err_t lastErr;			//error del ultimo AT+QISEND que fallo (BG_OK si no hay)
+	bg_txCoalesceStats_t stats;
+};
+
+struct bg_largeSend_t
+{
+	uint32_t len;
+	uint32_t next;			//offset del siguiente segmento a encolar
+	uint32_t done;			//offset hasta donde terminaron los segmentos (terminan en orden)
+	uint8_t inflight;		//segmentos en la cola del motor de comandos
+	uint8_t query;			//1: AT+QISEND=<connectID>,0 en la cola
+	uint8_t hold;			//1: demasiados bytes sin ACK, no se encolan segmentos
+	uint32_t sinceQuery;	//bytes encolados desde la ultima consulta
+	uint32_t nextQuery;		//instante de la siguiente consulta durante la pausa
+	bg_err_t err;
+	bg_largeSendStats_t stats;
+};
+
+struct bg_openPend_t
+{
+	uint8_t active;				//1: AT+QIOPEN enviado, se espera +QIOPEN
+	bg_openCallback_t callback;
+	void *ctx;
+	uint32_t deadline;			//limite de espera de +QIOPEN
+	uint8_t closing;			//1: sin +QIOPEN a tiempo, AT+QICLOSE en curso
+	uint8_t hasResult;			//1: llego +QIOPEN, bg_open_poll() aplica result
+	uint16_t result;			//<err> de +QIOPEN
+};
+
+struct bg_poolEntry_t
+{
+	uint8_t pooled;			//1: el socket lo abrio bg_pool_acquire()
+	uint8_t inUse;			//1: entregado por bg_pool_acquire() y no liberado
+	uint32_t lastUseMs;		//instante de la ultima liberacion
+	uint8_t closing;		//1: AT+QICLOSE de bg_pool_poll() en curso
+	uint8_t closeFailed;	//1: fallo AT+QICLOSE, ya no se reutiliza y se reintenta en retryMs
+	uint32_t retryMs;		//instante del siguiente intento de AT+QICLOSE
+};
+
+struct bg_udpBatch_t
+{
+	const bg_udpDgram_t *dgram;
+	uint8_t queued[BG_TX_PIPELINE_DEPTH];	//indices de los datagramas en la cola (terminan en orden)
+	uint8_t head;		//posicion en queued del siguiente datagrama por terminar
+	uint8_t inflight;	//datagramas en la cola del motor de comandos
+	uint8_t sent;		//datagramas con SEND OK
+	uint32_t bytes;		//bytes de los datagramas con SEND OK
+	bg_err_t err;		//error del primer datagrama que fallo
+};
+
+//un datagrama invalido no se encola
+#define BG_UDP_DGRAM_OK(d) ((d)->data != NULL && (d)->len > 0 && (d)->len <= BG_QISEND_MAX_LEN)
+//-----------------------------------Definicion de tipos de variable, variables con alcance local end-------------
+
+
+//-----------------------------------Flags--------------------------------------------
+#define flg_uart_bg flag.f0 //1: se recibio un mensjae por interrupcion de uart.
+#define flg_ri_bg flag.f2 //1: se detecto un flanco de bajada en MAIN_RI estando en modo transparente
+#define NOMBRE_USR_4 flag.f3 
+#define NOMBRE_USR_5 flag.f4
+#define NOMBRE_USR_6 flag.f5
+#define NOMBRE_USR_7 flag.f6
+#define NOMBRE_USR_8 flag.f7
+static flags_t flag = {0}; //banderas de 1 bit
+//-----------------------------------Flags end----------------------------------------
+
+
+//-----------------------------------Buffers------------------------------------------
+#if (SIZE_BG_RING_BUFF & (SIZE_BG_RING_BUFF - 1)) || (SIZE_BG_RING_BUFF > 32768)
+#error "SIZE_BG_RING_BUFF debe ser potencia de 2 y menor o igual a 32768"
+#endif
+
+#define BG_RING_MASK (SIZE_BG_RING_BUFF - 1)
+
+//Barrera de memoria para publicar los datos escritos antes de mover los indices del buffer circular.
+#define BG_MEMORY_BARRIER() __sync_synchronize()
+
+//bgRxRing es el buffer circular en donde la interrupcion de UART deposita los bytes recibidos del modulo.
+static bg_ring_t bgRxRing = {.head = 0, .tail = 0, .lost = 0};
+
+//valor de bgRxRing.lost ya reportado por el consumidor (el consumidor nunca escribe lost).
+static uint32_t bgRxLostReported = 0;
+
+//bgResp es el buffer en donde se arma (fuera de la interrupcion) la respuesta del comando AT en curso.
+static uartBuff_t bgResp = {.buff = {'\0'}, .len = 0};
+
+//posicion en bgResp del inicio de la linea que esta armando el tokenizador.
+static uint16_t bgRespLineStart = 0;
+//-----------------------------------Buffers end--------------------------------------
+
+
+//-----------------------------------Tokenizador--------------------------------------
+//bgRxTokens contiene un bit (BG_TOKEN_MASK) por cada token generado desde la ultima transaccion.
+static volatile uint32_t bgRxTokens = 0;
+
+//numero de bytes binarios pendientes despues de una linea "+QIRD: <len>" (no se tokenizan).
+static uint16_t bgRxRaw = 0;
+
+//direct push mode: bytes que faltan del URC "recv" en curso, bytes ya copiados y su connectID.
+static uint16_t bgRxPush = 0;
+static uint16_t bgPushLen = 0;
+static uint8_t bgPushID = 0;
+static uint8_t bgPushBuff[SIZE_BG_PUSH_BUFF];
+
+//prefijo de la linea esperada (cadena vacia si no se espera ninguna) y posicion en bgResp de la linea que coincidio.
+static uint8_t bgExpect[32] = {'\0'};
+static uint16_t bgExpectPos = 0;
+
+//cantidad de caracteres de "NO CARRIER" que ya coincidieron en el flujo de modo transparente.
+static uint8_t bgNoCarrierIdx = 0;
+
+//connectID que pasara a modo transparente al recibir "CONNECT" (BG_TM_NO_PENDING si no hay ninguno).
+#define BG_TM_NO_PENDING 0xFF
+static uint8_t bgTmPendingID = BG_TM_NO_PENDING;
+
+//1: el modulo esta en modo datos. statusTM no sirve para esto porque bg_mainRICallback() lo pone en INACTIVE desde
+//la interrupcion antes de que se haga la salida, este solo lo limpian NO CARRIER, el escape y el reinicio del modulo.
+static volatile uint8_t bgTmDataMode = 0;
+
+//AT+QICFG="transwaittm" deseado y el que tiene configurado el modulo (BG_TM_CFG_UNKNOWN despues de encender).
+#define BG_TM_CFG_UNKNOWN 0xFF
+static uint8_t bgTmWaitTime = BG_TM_WAIT_TIME;
+static uint8_t bgTmWaitTimeModule = BG_TM_CFG_UNKNOWN;
+
+//Regreso a modo transparente: solo se intenta despues de una salida, con histeresis y espera creciente.
+static bg_tmReentry_t bgTmReentry = {.delayMs = BG_TM_REENTRY_DELAY_MS, .maxDelayMs = BG_TM_REENTRY_MAX_DELAY_MS,\
+	.maxTries = BG_TM_REENTRY_MAX_TRIES};
+static uint8_t bgTmReentryTries = 0;		//intentos pendientes (0: no hay regreso programado)
+static uint32_t bgTmReentryDelay = 0;		//espera actual entre intentos (ms)
+static uint32_t bgTmReentryAt = 0;			//instante del siguiente intento
+
+/**
+ * @brief Tabla de lineas que generan un token. Si prefix es 1 basta con que la linea empiece con str.
+ * 
+ */
+static const struct
+{
+	const char *str;
+	bg_token_t token;
+	uint8_t prefix;
+}bgTokenTbl[] = {
+	{"OK", BG_TOK_OK, 0},
+	{"ERROR", BG_TOK_ERROR, 0},
+	{"SEND OK", BG_TOK_SEND_OK, 0},
+	{"SEND FAIL", BG_TOK_SEND_FAIL, 0},
+	{"+CME ERROR: ", BG_TOK_CME_ERROR, 1},
+	{"+CMS ERROR: ", BG_TOK_CMS_ERROR, 1},
+	{"CONNECT", BG_TOK_CONNECT, 1},
+	{"NO CARRIER", BG_TOK_NO_CARRIER, 0},
+	{"RDY", BG_TOK_RDY, 0},
+	{"APP RDY", BG_TOK_RDY, 0},
+	{"POWERED DOWN", BG_TOK_POWERED_DOWN, 0}
+};
+//comando AT en curso. Sus lineas "+<nombre>:" son respuesta y no URC. Se limpia al llegar el resultado final.
+static uint8_t bgCmdLine[BG_CMD_MAX_LEN] = {'\0'};
+//codigo <err> del ultimo "+CME ERROR"/"+CMS ERROR" (0 si el comando en curso no lo genero)
+static uint16_t bgCmeError = 0;
+
+/**
+ * @brief Tabla de URC soportados.
+ * 
+ * NOTE: La tabla DEBE mantenerse ordenada alfabeticamente (orden ASCII) por prefijo, ya que bg_match_urc()
+ * la recorre como un arbol de prefijos. Agregar un URC no agrega costo por byte recibido.
+ */
+static const bg_urcEntry_t bgUrcTbl[] = {
+	{"+CEREG: ", BG_URC_CEREG, bg_parse_urc_cereg, 0},
+	{"+CPIN: ", BG_URC_CPIN, bg_parse_urc_cpin, 0},
+	{"+QIOPEN: ", BG_URC_QIOPEN, bg_parse_urc_qiopen, 1},
+	{"+QIURC: \"closed\"", BG_URC_CLOSED, bg_parse_urc_connectID, 0},
+	{"+QIURC: \"incoming full\"", BG_URC_INCOMING_FULL, NULL, 0},
+	{"+QIURC: \"incoming\"", BG_URC_INCOMING, bg_parse_urc_incoming, 0},
+	{"+QIURC: \"pdpdeact\"", BG_URC_PDP_DEACT, bg_parse_urc_contextID, 0},
+	{"+QIURC: \"recv\"", BG_URC_RECV, bg_parse_urc_connectID, 0}
+};
+
+#define BG_URC_TBL_SIZE (sizeof(bgUrcTbl) / sizeof(bgUrcTbl[0]))
+//-----------------------------------Tokenizador end----------------------------------
+
+
+//-----------------------------------Motor de comandos--------------------------------
+#define BG_CMD_SEND_MASK (BG_TOKEN_MASK(BG_TOK_SEND_OK) | BG_TOKEN_MASK(BG_TOK_SEND_FAIL) | BG_TOKEN_MASK(BG_TOK_ERROR))
+
+static bg_cmd_t bgCmdQueue[BG_CMD_QUEUE_LEN];	//cola circular de comandos AT pendientes
+static uint8_t bgCmdHead = 0;					//comando en curso (o siguiente en enviarse)
+static uint8_t bgCmdCount = 0;					//numero de comandos en la cola
+static bg_cmdState_t bgCmdState = BG_CMD_IDLE;
+static uint32_t bgCmdDeadline = 0;				//instante limite (ms) de la fase en curso
+static uint32_t bgCmdSeq = 0;					//numero de secuencia para el Log
+//-----------------------------------Motor de comandos end----------------------------
+
+
+//-----------------------------------Perfil de configuracion--------------------------
+/**
+ * @brief Perfil de configuracion de la libreria. Los parametros de AT+QCFG y AT+QURCCFG los guarda el modulo en NV
+ * al establecerlos, AT+CEREG y AT+CMEE se guardan con AT&W0.
+ */
+static const bg_cfgItem_t bgCfgProfile[] = {
+	//Deshabilita el modo echo del modulo 
+	{.query = NULL, .expect = NULL, .set = "ATE0", .persist = 0},
+	//Configura UART1 para salida de URC
+	{.query = "AT+QURCCFG=\"urcport\"", .expect = "\"urcport\",\"uart1\"", .set = "AT+QURCCFG=\"urcport\",\"uart1\"", .persist = 0},
+	//Se activa señal en pin MAIN_RI
+	{.query = "AT+QCFG=\"risignaltype\"", .expect = "\"risignaltype\",\"respective\"",\
+		.set = "AT+QCFG=\"risignaltype\",\"respective\"", .persist = 0},
+	//Se desactiva URC de llamadas
+	{.query = "AT+QCFG=\"urc/ri/ring\"", .expect = "\"urc/ri/ring\",\"off\"", .set = "AT+QCFG=\"urc/ri/ring\",\"off\"", .persist = 0},
+	//Se desactiva URC SMS
+	{.query = "AT+QCFG=\"urc/ri/smsincoming\"", .expect = "\"urc/ri/smsincoming\",\"off\"",\
+		.set = "AT+QCFG=\"urc/ri/smsincoming\",\"off\"", .persist = 0},
+	//Configura un unico pulso de MAIN_RI a 80ms
+	{.query = "AT+QCFG=\"urc/ri/other\"", .expect = "\"urc/ri/other\",\"pulse\",80,1",\
+		.set = "AT+QCFG=\"urc/ri/other\",\"pulse\",80,1", .persist = 0},
+	//No hay retardo (0 en vez de 100 )despues del pulso para salida de URC en UART
+	{.query = "AT+QCFG=\"urc/delay\"", .expect = "\"urc/delay\",100", .set = "AT+QCFG=\"urc/delay\",100", .persist = 0},
+	//Activa URC de estado de registro en red y ubicacion
+	{.query = "AT+CEREG?", .expect = "+CEREG: 2,", .set = "AT+CEREG=2", .persist = 1},
+	//Especifica secuencia de busqueda LTE
+	{.query = "AT+QCFG=\"nwscanseq\"", .expect = "\"nwscanseq\",020301", .set = "AT+QCFG=\"nwscanseq\",020301", .persist = 0},
+	//Configura la categoria de busqueda
+	{.query = "AT+QCFG=\"iotopmode\"", .expect = "\"iotopmode\",2", .set = "AT+QCFG=\"iotopmode\",2,1", .persist = 0},
+	//Habilita busqueda de bandas B2, B4 y B28
+	{.query = "AT+QCFG=\"band\"", .expect = "\"band\",0x0,0x800000a,0x1", .set = "AT+QCFG=\"band\", 0,800000A,1", .persist = 0},
+	//Configura respuesta de formato de COPS a numerica (AT+COPS? solo muestra el formato registrado en una red)
+	{.query = NULL, .expect = NULL, .set = "AT+COPS=3, 2", .persist = 0},
+	//Habilita "+CME ERROR: <err>" con codigo numerico en lugar de solo "ERROR"
+	{.query = "AT+CMEE?", .expect = "+CMEE: 1", .set = "AT+CMEE=1", .persist = 1}
+};
+//-----------------------------------Perfil de configuracion end----------------------
+
+
+//-----------------------------------Arranque de red----------------------------------
+#define BG_BRINGUP_BIT(stage) (1U << (stage))
+
+//1: el modulo ya se encendio y configuro (bg_init_module o la etapa de encendido del arranque)
+static uint8_t bgModuleInit = 0;
+
+static bg_bringup_t bgBringup = {.cfg = NULL, .stats = {.stage = BG_BRINGUP_IDLE}};
+
+//timeout de cada etapa (0: la etapa termina con el timeout de su comando)
+static const uint32_t bgBringupTimeout[BG_BRINGUP_DONE] = {0, BG_BRINGUP_SIM_TIMEOUT, 0,\
+	BG_BRINGUP_ATTACH_TIMEOUT, BG_BRINGUP_PDP_TIMEOUT, BG_BRINGUP_SCKT_TIMEOUT};
+
+//error con el que falla cada etapa al exceder su timeout
+static const bg_err_t bgBringupErr[BG_BRINGUP_DONE] = {BG_ERR_TIMEOUT_ANS, BG_ERR_SIM_NO_OK, BG_ERR_CONF_PDP,\
+	BG_ERR_ATTACH_NO_OK, BG_ERR_ACT_PDP, BG_ERR_OPEN_SCKT};
+//-----------------------------------Arranque de red end------------------------------
+
+
+//-----------------------------------Tabla de sockets---------------------------------
+#define BG_SCKT_NONE 0xFF //connectID invalido (linea +QISTATE que no se pudo parsear)
+
+static bg_scktInfo_t bgScktTbl[BG_CONNECT_ID_MAX + 1]; //estado de cada connectID (se actualiza con comandos y URC)
+
+//servicio de la tabla de sockets que corresponde a cada bgServiceType_t de bg_open_sckt()
+static const bg_scktService_t bgOpenService[] = {BG_SCKT_SERVICE_TCP_LISTENER, BG_SCKT_SERVICE_TCP,\
+	BG_SCKT_SERVICE_UDP, BG_SCKT_SERVICE_UDP_SERVICE};
+
+//los servicios con destino fijo usan ip y remotePort, los demas escuchan en localPort
+#define BG_OPEN_HAS_REMOTE(type) ((type) == BG_OPEN_CLIENT || (type) == BG_OPEN_UDP)
+
+//<service_type> de AT+QISTATE (y de AT+QIOPEN) indexado por bg_scktService_t
+static const char *const bgScktServiceStr[BG_SCKT_SERVICE_UNKNOWN] = {"TCP", "UDP", "TCP LISTENER",\
+	"TCP INCOMING", "UDP SERVICE"};
+
+static bg_pdpInfo_t bgPdpTbl[BG_CONTEXT_ID_MAX - BG_CONTEXT_ID_MIN + 1]; //estado de cada contextID (indice contextID - 1)
+
+#define BG_QISTATE_RESP_LEN ((BG_CONNECT_ID_MAX + 1) * 96)	//respuesta de AT+QISTATE con los 12 connectID
+#define BG_QIACT_RESP_LEN ((BG_CONTEXT_ID_MAX - BG_CONTEXT_ID_MIN + 1) * 64)	//respuesta de AT+QIACT? con los 7 contextos
+
+//respuestas de AT+QISTATE (primeros BG_QISTATE_RESP_LEN bytes) y AT+QIACT? de bg_refresh_sckt_table(), es estatico
+//para no ocupar 1.6KB de stack en las llamadas desde el manejo de URC.
+static uint8_t bgRefreshResp[BG_QISTATE_RESP_LEN + BG_QIACT_RESP_LEN];
+//-----------------------------------Tabla de sockets end-----------------------------
+
+
+//-----------------------------------Apertura asincrona-------------------------------
+static bg_openPend_t bgOpenPend[BG_CONNECT_ID_MAX + 1];	//apertura asincrona en curso de cada connectID
+//-----------------------------------Apertura asincrona end---------------------------
+
+
+//-----------------------------------Pool de conexiones-------------------------------
+static uint16_t bgConnectIDMap;							//bit por connectID reservado con bg_alloc_connect_id()
+static bg_poolEntry_t bgPool[BG_CONNECT_ID_MAX + 1];	//estado en el pool de cada connectID
+static bg_poolStats_t bgPoolStats;
+//-----------------------------------Pool de conexiones end---------------------------
+
+
+//-----------------------------------Envio agrupado-----------------------------------
+#define BG_TX_BUFF_FREE 0
+#define BG_TX_BUFF_FILLING 1
+#define BG_TX_BUFF_SENDING 2
+
+static bg_txBuff_t bgTxPool[BG_TX_POOL_LEN];					//buffers compartidos por todos los sockets
+static bg_txCoalesce_t bgTxCoalesce[BG_CONNECT_ID_MAX + 1];	//envio agrupado de cada connectID
+//-----------------------------------Envio agrupado end-------------------------------
+
+
+//-----------------------------------Counters-----------------------------------------
+static volatile uint32_t bgTickMs;			//contador monotono de ms (base de tiempo de todos los timeouts)
+static uint32_t bgTmLastTx;					//instante (ms) del ultimo envio en modo transparente (tiempo de guarda de "+++")
+//-----------------------------------Counters end-------------------------------------
+
+
+//----------------------------------Queue--------------------------------------------
+ColaRec_t bgUrcQueue; //cola para eventos URC detectados
+static uint8_t bgUrcArena[SIZE_BG_URC_ARENA]; //arreglo donde se guardan los URC encolados con su longitud real
+ColaRec_t bgPushQueue; //cola de datos recibidos en direct push mode (el tipo del registro es el connectID)
+static uint8_t bgPushArena[SIZE_BG_PUSH_ARENA];
+//----------------------------------Queue end----------------------------------------
+
+
+//-----------------------------------BSP----------------------------------------------
+//puntero a funcion para funcion de transmision por UART en puerto BG
+static uartFun_t bgUartTx;
+//puntero a funcion para escribir estado en pin de salida gpio (BG_PWRKEY_PIN, BG_VBAT_PIN, BG_RESET_PIN, BG_PON_TRIG_PIN) 
+static gpioWriteFun_t bgGpioWrite;
+//puntero a funcion para generar delays en ms
+static delayFun_t bgDelay;
+//puntero a funcion para reiniciar al MCU
+static resetFun_t bgResetMCU;
+//puntero a funcion opcional para bloquear hasta que llegue un evento de recepcion (NULL: espera activa)
+static waitEventFun_t bgWaitEvent;
+//puntero a funcion opcional para despertar a bgWaitEvent desde la interrupcion
+static notifyEventFun_t bgNotifyEvent;
+//Puntero a funcion de lectura del pin STATUS (opcional)
+static statusReadFun_t bgStatusRead;
+//1: el BSP controla MAIN_DTR
+static uint8_t bgDtrPin;
+//puntero a funcion opcional para transmitir varios segmentos seguidos (NULL: un bgUartTx por segmento)
+static uartTxvFun_t bgUartTxv;
+
+void bg_set_bsp(bg_bspFun_t bspFun)
+{
+	bgUartTx = bspFun.uartTx;
+	bgGpioWrite = bspFun.gpioWrite;
+	bgDelay = bspFun.msDelay;
+	bgResetMCU = bspFun.resetMCU;
+	bgWaitEvent = bspFun.waitEvent;
+	bgNotifyEvent = bspFun.notifyEvent;
+	bgStatusRead = bspFun.statusRead;
+	bgDtrPin = bspFun.dtrPin;
+	bgUartTxv = bspFun.uartTxv;
+	flg_uart_bg = 0;
+	flg_ri_bg = 0;
+
+	create_rec_queue(&bgUrcQueue, bgUrcArena, SIZE_BG_URC_ARENA);
+	create_rec_queue(&bgPushQueue, bgPushArena, SIZE_BG_PUSH_ARENA);
+}
+//-----------------------------------BSP end-----------------------------------
+
+
+//---------------------------Callbacks MCU para LIB----------------------------
+void bg_callback_ms(void)
+{
+	bgTickMs++;
+}
+
+uint32_t bg_get_tick_ms(void)
+{
+	return bgTickMs;
+}
+
+void bg_uartCallback(uint8_t *buff, uint16_t nBytes)
+{
+	if(buff == NULL || nBytes == 0) return;
+
+	bg_ring_write(&bgRxRing, buff, nBytes);
+	flg_uart_bg = 1;
+
+	//solo se despierta al que espera cuando puede haber una linea completa o el prompt '>'
+	if(bgNotifyEvent != NULL && (memchr(buff, '\n', nBytes) != NULL || memchr(buff, '>', nBytes) != NULL))
+		bgNotifyEvent();
+}
+
+void bg_mainRICallback(mainRiEdge_t edge)
+{
+	if(edge == MAIN_RI_EDGE_FALLING)
+	{
+		bg_infoTM_t infoTM = bg_getter_transparentMode();
+		
+		if(infoTM.statusTM == BG_TM_INACTIVE) return;
+
+		bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = infoTM.statusNoCarrier,\
+			.connectID = infoTM.connectID};
+		bg_setter_transparentMode(valueTM);
+
+		//la cola solo se escribe desde el contexto principal, el evento se encola en bg_rx_process()
+		flg_ri_bg = 1;
+
+		if(bgNotifyEvent != NULL)
+			bgNotifyEvent();
+	}
+
+	else if(edge == MAIN_RI_EDGE_RISING)
+	{
+		
+	}
+}
+
+static uint8_t bg_detect_urc(uint8_t *buff, uint16_t len)
+{
+	int idx = bg_match_urc(buff, len);
+
+	if(idx < 0) return 0;
+
+	LOG_BG(LE, "URC MATCH [%d]\n", idx);
+
+	if(len >= SIZE_URC_BUFF) len = SIZE_URC_BUFF - 1;
+
+	//la vista apunta al renglon en bgResp, bg_queue_put() copia solo los bytes del URC
+	urcRawData_t urcDetected = {.buff = buff, .len = len, .type = bgUrcTbl[idx].type};
+	bg_callback_urcDetected(urcDetected);
+
+	return 1;
+}
+
+static int bg_match_urc(uint8_t *line, uint16_t len)
+{
+	int lo = 0, hi = BG_URC_TBL_SIZE, best = -1;
+
+	for(uint16_t depth = 0; lo < hi; depth++)
+	{
+		//un prefijo que termina en esta profundidad queda primero en el rango por estar ordenada la tabla
+		if(bgUrcTbl[lo].prefix[depth] == '\0')
+			best = lo++;
+
+		if(depth >= len) break;
+
+		while(lo < hi && (uint8_t)bgUrcTbl[lo].prefix[depth] < line[depth])
+			lo++;
+
+		int end = lo;
+		while(end < hi && (uint8_t)bgUrcTbl[end].prefix[depth] == line[depth])
+			end++;
+
+		hi = end;
+	}
+
+	return best;
+}
+
+static const bg_urcEntry_t *bg_urc_entry(bg_urcType_t type)
+{
+	for(int i = 0; i < BG_URC_TBL_SIZE; i++)
+		if(bgUrcTbl[i].type == type)
+			return &bgUrcTbl[i];
+
+	return NULL;
+}
+
+static void bg_parse_urc_connectID(uint8_t *fields, urcInfoData_t *infoUrc)
+{
+	//,<connectID>[,<len>] (<len> solo en "recv" de direct push mode)
+	uint8_t *parsePtr = strchr(fields, ',');
+
+	if(parsePtr == NULL) return;
+
+	infoUrc->connectID = atoi(++parsePtr);
+	parsePtr = strchr(parsePtr, ',');
+
+	if(parsePtr)
+		infoUrc->len = atoi(parsePtr + 1);
+}
+
+static void bg_parse_urc_incoming(uint8_t *fields, urcInfoData_t *infoUrc)
+{
+	//,<connectID>,<serverID>,<remoteIP>,<remote_port>
+	uint8_t *parsePtr = strchr(fields, ',');
+
+	if(parsePtr == NULL) return;
+
+	infoUrc->connectID = atoi(++parsePtr);
+	parsePtr = strchr(parsePtr, ',');
+
+	if(parsePtr)
+		infoUrc->serverID = atoi(parsePtr + 1);
+}
+
+static void bg_parse_urc_contextID(uint8_t *fields, urcInfoData_t *infoUrc)
+{
+	//,<contextID>
+	uint8_t *parsePtr = strchr(fields, ',');
+
+	if(parsePtr)
+		infoUrc->contextID = atoi(parsePtr + 1);
+}
+
+static void bg_parse_urc_cereg(uint8_t *fields, urcInfoData_t *infoUrc)
+{
+	//<stat>[,<tac>,<ci>,<AcT>]
+	infoUrc->result = atoi(fields);
+}
+
+static void bg_parse_urc_qiopen(uint8_t *fields, urcInfoData_t *infoUrc)
+{
+	//<connectID>,<err>
+	infoUrc->connectID = atoi(fields);
+	uint8_t *parsePtr = strchr(fields, ',');
+
+	if(parsePtr)
+		infoUrc->result = atoi(parsePtr + 1);
+}
+
+static void bg_parse_urc_cpin(uint8_t *fields, urcInfoData_t *infoUrc)
+{
+	//<code> (READY, SIM PIN, SIM PUK...)
+	infoUrc->result = !strncmp(fields, "READY", 5);
+}
+
+void bg_handle_urc(void)
+{
+	bg_poll();
+	bg_tx_coalesce_poll();
+	bg_open_poll();
+	bg_pool_poll();
+
+	//los bloques de direct push mode traen su connectID y longitud, no tienen renglon en la cola de URC
+	if(bg_recv_push())
+		return;
+
+	if(bg_queue_is_empty()) 
+	{
+		LOG_BG(LD, "queue is empty\n");
+
+		bg_infoTM_t infoTM = bg_getter_transparentMode();
+
+		//solo despues de una salida de TM y cuando se cumple la espera, nunca se consulta al modulo en cada pasada
+		if(infoTM.statusTM == BG_TM_INACTIVE && bgTmReentryTries > 0 &&\
+			BG_DEADLINE_REACHED(bg_get_tick_ms(), bgTmReentryAt))
+		{
+			bgTmReentryTries--;
+			bg_callback_TM_Inactive(infoTM.connectID, infoTM.statusNoCarrier);
+
+			if(bg_getter_transparentMode().statusTM == BG_TM_INACTIVE && bgTmReentryTries > 0)
+			{
+				bgTmReentryDelay = (bgTmReentryDelay * 2 < bgTmReentry.maxDelayMs) ? bgTmReentryDelay * 2 : bgTmReentry.maxDelayMs;
+				bgTmReentryAt = bg_get_tick_ms() + bgTmReentryDelay;
+			}
+		}
+
+		return;
+	}
+
+	//mientras lleguen URC no se regresa a TM (histeresis)
+	if(bgTmReentryTries > 0)
+		bgTmReentryAt = bg_get_tick_ms() + bgTmReentryDelay;
+
+	bg_infoTM_t infoTM = bg_getter_transparentMode();
+	if(infoTM.statusTM == BG_TM_ACTIVE)
+		if(bg_exit_transparent_mode() == BG_OK_EXIT_TRANSPARENT_MODE)
+			LOG_BG(LE, "*Salida de TM Exitosa*\n");
+
+	urcRawData_t urcPop;
+	bg_queue_pop(&urcPop);
+
+	LOG_BG(LE,"\nlen:%ld\ntype:%d\nbuff: %s", urcPop.len, urcPop.type, urcPop.buff);
+	urcInfoData_t infoUrc = {.buff = {'\0'}, .len = 0, .type = urcPop.type};
+
+	//los campos se parsean con la funcion del renglon de la tabla de URC
+	const bg_urcEntry_t *entry = bg_urc_entry(urcPop.type);
+
+	if(entry != NULL && entry->parser != NULL)
+		entry->parser(&urcPop.buff[strlen(entry->prefix)], &infoUrc);
+
+	//ya se parsearon los campos, el espacio del URC se libera antes de enviar comandos
+	bg_queue_release();
+
+	bg_sckt_urc(&infoUrc);
+	bg_bringup_urc(&infoUrc);
+
+	switch(urcPop.type)
+	{
+		case BG_URC_EXIT_TM:
+			if(bg_exit_transparent_mode() == BG_OK_EXIT_TRANSPARENT_MODE)
+			{
+				LOG_BG(LE, "Salida de TM Exitosa\n");
+			}
+			else
+			{	
+				bg_infoTM_t infoTM = bg_getter_transparentMode();
+
+				if(infoTM.statusNoCarrier == BG_TM_NO_CARRIER_SET)
+					LOG_BG(LE, "Salida de TM por desconexion NO CARRIER\n");
+				// else
+				// {
+				// 	LOG_BG(LE, "Salida de TM NO Exitosa\n");
+				// 	bg_infoTM_t valueTM = {.statusTM = BG_TM_ACTIVE, .statusNoCarrier = infoTM.statusNoCarrier,\
+				// 		 .connectID = infoTM.connectID};
+				// 	bg_setter_transparentMode(valueTM);
+				// }
+			}
+		break;
+
+		case BG_URC_RECV:
+			//se entrega un bg_urc_parsed_callback() por cada bloque hasta vaciar el buffer del modulo
+			bg_receive_stream(infoUrc.connectID, bg_recv_urc_sink, &infoUrc, NULL);
+		break;
+
+		case BG_URC_NO_CARRIER:
+			{
+				bg_infoTM_t infoTM = bg_getter_transparentMode();
+				bg_close_sckt(infoTM.connectID);
+			}
+		break;
+
+		default:
+			if(entry != NULL)
+				bg_urc_parsed_callback(infoUrc);
+		break;
+	}
+}
+//---------------------------Callbacks MCU para LIB end----------------------------
+
+
+//-----------------------------Buffer circular de recepcion--------------------------
+static uint16_t bg_ring_write(bg_ring_t *ring, const uint8_t *data, uint16_t len)
+{
+	uint16_t head = ring->head;
+	uint16_t freeBytes = SIZE_BG_RING_BUFF - (uint16_t)(head - ring->tail);
+
+	if(len > freeBytes)
+	{
+		ring->lost += len - freeBytes;
+		len = freeBytes;
+	}
+
+	uint16_t idx = head & BG_RING_MASK;
+	uint16_t first = SIZE_BG_RING_BUFF - idx;
+
+	if(first > len) first = len;
+
+	memcpy(&ring->buff[idx], data, first);
+	memcpy(ring->buff, data + first, len - first);
+
+	BG_MEMORY_BARRIER();
+	ring->head = head + len;
+
+	return len;
+}
+
+static uint16_t bg_ring_span(bg_ring_t *ring, uint8_t **data)
+{
+	uint16_t head = ring->head;
+	BG_MEMORY_BARRIER();
+
+	uint16_t tail = ring->tail;
+	uint16_t count = head - tail;
+	uint16_t idx = tail & BG_RING_MASK;
+
+	if(count > SIZE_BG_RING_BUFF - idx) count = SIZE_BG_RING_BUFF - idx;
+
+	*data = &ring->buff[idx];
+	return count;
+}
+
+static void bg_wait_event(uint32_t deadline)
+{
+	uint32_t remaining = deadline - bg_get_tick_ms();
+
+	if(BG_DEADLINE_REACHED(bg_get_tick_ms(), deadline))
+		return;
+
+	if(bgWaitEvent != NULL)
+		bgWaitEvent((remaining < BG_WAIT_EVENT_MAX_MS) ? remaining : BG_WAIT_EVENT_MAX_MS);
+	else
+		__asm__("nop");
+}
+
+static void bg_ring_release(bg_ring_t *ring, uint16_t len)
+{
+	BG_MEMORY_BARRIER();
+	ring->tail = ring->tail + len;
+}
+
+static void bg_rx_process(void)
+{
+	uint8_t *span = NULL;
+	uint16_t len = 0;
+
+	while((len = bg_ring_span(&bgRxRing, &span)) > 0)
+	{
+		bg_rx_handle(span, len);
+		bg_ring_release(&bgRxRing, len);
+	}
+
+	//lost se lee una sola vez, la resta es valida aunque el contador de 32 bits de la vuelta
+	uint32_t lost = bgRxRing.lost;
+
+	if(lost != bgRxLostReported)
+	{
+		LOG_BG(LE, "[BG_ERR] RX OVERFLOW, BYTES PERDIDOS: %lu\n", lost - bgRxLostReported);
+		bgRxLostReported = lost;
+	}
+
+	if(flg_ri_bg)
+	{
+		flg_ri_bg = 0;
+
+		urcRawData_t tmExit = {.buff = (uint8_t *)"mainRI", .len = 6, .type = BG_URC_EXIT_TM};
+		bg_queue_put(tmExit);
+	}
+}
+
+static void bg_rx_handle(uint8_t *data, uint16_t len)
+{
+	uint16_t i = 0;
+
+	while(i < len)
+	{
+		if(bg_getter_transparentMode().statusTM == BG_TM_ACTIVE)
+		{
+			i += bg_rx_tm_data(&data[i], len - i);
+			continue;
+		}
+
+		if(bgRxPush)
+		{
+			i += bg_rx_push_data(&data[i], len - i);
+			continue;
+		}
+
+		//al recibir "CONNECT" se pasa a modo transparente y el resto del tramo ya son datos (igual con un URC
+		//"recv" de direct push mode)
+		while(i < len && !bgRxPush && bg_getter_transparentMode().statusTM == BG_TM_INACTIVE)
+			bg_rx_token_byte(data[i++]);
+	}
+}
+
+static uint16_t bg_rx_tm_data(uint8_t *data, uint16_t len)
+{
+	const char noCarrier[] = "NO CARRIER";
+	uint8_t connectID = bg_getter_transparentMode().connectID;
+
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if(data[i] == (uint8_t)noCarrier[bgNoCarrierIdx])
+			bgNoCarrierIdx++;
+		else
+			bgNoCarrierIdx = (data[i] == (uint8_t)noCarrier[0]) ? 1 : 0;
+
+		if(bgNoCarrierIdx == sizeof(noCarrier) - 1)
+		{
+			//se entregan los datos previos a "NO CARRIER" que llegaron en este mismo tramo
+			if(i + 1 > sizeof(noCarrier) - 1)
+			{
+				bg_callback_receive_TM(data, i + 1 - (sizeof(noCarrier) - 1));
+
+				if(connectID <= BG_CONNECT_ID_MAX)
+					bgScktTbl[connectID].rxBytes += i + 1 - (sizeof(noCarrier) - 1);
+			}
+
+			bgNoCarrierIdx = 0;
+			bg_no_carrier_event();
+			return i + 1;
+		}
+	}
+
+	//en modo transparente los datos se entregan al usuario directamente desde el buffer circular
+	bg_callback_receive_TM(data, len);
+
+	if(connectID <= BG_CONNECT_ID_MAX)
+		bgScktTbl[connectID].rxBytes += len;
+
+	return len;
+}
+
+static uint16_t bg_rx_push_data(uint8_t *data, uint16_t len)
+{
+	uint16_t n = (len < bgRxPush) ? len : bgRxPush;
+	uint16_t room = SIZE_BG_PUSH_BUFF - bgPushLen;
+	uint16_t cpy = (n < room) ? n : room;
+
+	memcpy(&bgPushBuff[bgPushLen], data, cpy);
+	bgPushLen += cpy;
+	bgRxPush -= n;
+
+	if(bgRxPush) return n;
+
+	bgScktTbl[bgPushID].rxBytes += bgPushLen;
+
+	if(bgPushQueue.put(&bgPushQueue, bgPushID, bgPushBuff, bgPushLen) != 0)
+		LOG_BG(LE, "[BG_ERR] COLA DE DIRECT PUSH LLENA, %d BYTES DESCARTADOS DEL connectID: %d\n", bgPushLen, bgPushID);
+
+	return n;
+}
+
+static uint8_t bg_rx_push_start(uint8_t *line, uint16_t textLen)
+{
+	const char prefix[] = "+QIURC: \"recv\",";
+
+	if(textLen <= sizeof(prefix) - 1 || memcmp(line, prefix, sizeof(prefix) - 1))
+		return 0;
+
+	uint8_t *comma = memchr(&line[sizeof(prefix) - 1], ',', textLen - (sizeof(prefix) - 1));
+
+	//sin <len> es el URC de buffer access mode
+	if(comma == NULL) return 0;
+
+	uint8_t connectID = atoi(&line[sizeof(prefix) - 1]);
+	uint16_t len = atoi(comma + 1);
+
+	if(connectID > BG_CONNECT_ID_MAX || len == 0) return 0;
+
+	if(len > SIZE_BG_PUSH_BUFF)
+		LOG_BG(LE, "[BG_ERR] DIRECT PUSH DE %d BYTES, SE ENTREGAN %d\n", len, SIZE_BG_PUSH_BUFF);
+
+	//en UDP SERVICE el renglon trae ,"<remoteIP>",<remote_port> despues de <len>, no se requiere
+	bgPushID = connectID;
+	bgPushLen = 0;
+	bgRxPush = len;
+
+	return 1;
+}
+
+static uint8_t bg_rx_open_result(uint8_t *line, uint16_t textLen)
+{
+	const char prefix[] = "+QIOPEN: ";
+
+	if(textLen <= sizeof(prefix) - 1 || memcmp(line, prefix, sizeof(prefix) - 1))
+		return 0;
+
+	uint8_t *comma = memchr(&line[sizeof(prefix) - 1], ',', textLen - (sizeof(prefix) - 1));
+	uint8_t connectID = atoi(&line[sizeof(prefix) - 1]);
+
+	if(comma == NULL || connectID > BG_CONNECT_ID_MAX) return 0;
+
+	bg_openPend_t *pend = &bgOpenPend[connectID];
+
+	//las aperturas sincronas y las del arranque de red siguen llegando como URC
+	if(!pend->active || pend->closing) return 0;
+
+	pend->result = atoi(comma + 1);
+	pend->hasResult = 1;
+
+	return 1;
+}
+
+static void bg_rx_token_byte(uint8_t chr)
+{
+	bg_resp_append(chr);
+
+	if(bgRxRaw)
+	{
+		if(--bgRxRaw == 0)
+			bgRespLineStart = bgResp.len;
+		return;
+	}
+
+	if(chr == '\n')
+	{
+		bg_rx_line(&bgResp.buff[bgRespLineStart], bgResp.len - bgRespLineStart);
+		return;
+	}
+
+	//el prompt '>' no termina en salto de linea
+	if(chr == '>' && bgResp.len == bgRespLineStart + 1)
+		bgRxTokens |= BG_TOKEN_MASK(BG_TOK_PROMPT);
+}
+
+static void bg_rx_line(uint8_t *line, uint16_t len)
+{
+	uint16_t lineStart = bgRespLineStart;
+	bgRespLineStart = bgResp.len;
+
+	uint16_t textLen = len;
+	while(textLen > 0 && (line[textLen - 1] == '\n' || line[textLen - 1] == '\r'))
+		textLen--;
+
+	if(textLen == 0) return;
+
+	for(int i = 0; i < sizeof(bgTokenTbl) / sizeof(bgTokenTbl[0]); i++)
+	{
+		size_t strLen = strlen(bgTokenTbl[i].str);
+
+		if(textLen < strLen || (!bgTokenTbl[i].prefix && textLen != strLen)) continue;
+
+		if(memcmp(line, bgTokenTbl[i].str, strLen)) continue;
+
+		bgRxTokens |= BG_TOKEN_MASK(bgTokenTbl[i].token);
+
+		if(BG_TOKEN_MASK(bgTokenTbl[i].token) & BG_TOKEN_FINAL_MASK)
+			bgCmdLine[0] = '\0';
+
+		if(bgTokenTbl[i].token == BG_TOK_CME_ERROR || bgTokenTbl[i].token == BG_TOK_CMS_ERROR)
+			bgCmeError = atoi(&line[strLen]);
+
+		if(bgTokenTbl[i].token == BG_TOK_NO_CARRIER)
+			bg_no_carrier_event();
+
+		else if(bgTokenTbl[i].token == BG_TOK_CONNECT && bgTmPendingID != BG_TM_NO_PENDING)
+		{
+			bg_infoTM_t valueTM = {.statusTM = BG_TM_ACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_RESET,\
+				.connectID = bgTmPendingID};
+			bg_setter_transparentMode(valueTM);
+			bgTmPendingID = BG_TM_NO_PENDING;
+			bgNoCarrierIdx = 0;
+		}
+
+		return;
+	}
+
+	if(bgExpect[0] != '\0' && textLen >= strlen(bgExpect) && !memcmp(line, bgExpect, strlen(bgExpect)))
+	{
+		bgExpectPos = lineStart;
+		bgRxTokens |= BG_TOKEN_MASK(BG_TOK_EXPECTED) | BG_TOKEN_MASK(BG_TOK_LINE);
+		return;
+	}
+
+	//despues de "+QIRD: <len>" llegan <len> bytes binarios que no se deben tokenizar
+	if(textLen > 7 && !memcmp(line, "+QIRD: ", 7))
+	{
+		uint8_t *comma = memchr(line, ',', textLen);
+
+		if(comma == NULL || *(comma + 1) == '"')
+			bgRxRaw = atoi(&line[7]);
+
+		bgRxTokens |= BG_TOKEN_MASK(BG_TOK_LINE);
+		return;
+	}
+
+	//el URC de direct push mode se detecta hasta que llegan sus datos
+	if(bg_rx_push_start(line, textLen))
+	{
+		bgResp.len = bgRespLineStart = lineStart;
+		bgResp.buff[bgResp.len] = '\0';
+		bgRxTokens |= BG_TOKEN_MASK(BG_TOK_URC);
+		return;
+	}
+
+	if(!bg_rx_solicited(line, textLen) && (bg_rx_open_result(line, textLen) || bg_detect_urc(line, len)))
+	{
+		//los URC se retiran de la respuesta para no confundir a la transaccion en curso
+		bgResp.len = bgRespLineStart = lineStart;
+		bgResp.buff[bgResp.len] = '\0';
+		bgRxTokens |= BG_TOKEN_MASK(BG_TOK_URC);
+		return;
+	}
+
+	bgRxTokens |= BG_TOKEN_MASK(BG_TOK_LINE);
+}
+
+static void bg_resp_append(uint8_t chr)
+{
+	//si no cabe el byte se descartan las lineas completas mas antiguas
+	if(bgResp.len + 1 >= sizeof(bgResp.buff) && bgRespLineStart > 0)
+	{
+		bgResp.len -= bgRespLineStart;
+		memmove(bgResp.buff, &bgResp.buff[bgRespLineStart], bgResp.len);
+		bgExpectPos = (bgExpectPos >= bgRespLineStart) ? bgExpectPos - bgRespLineStart : 0;
+		bgRespLineStart = 0;
+	}
+
+	if(bgResp.len + 1 >= sizeof(bgResp.buff)) return;
+
+	bgResp.buff[bgResp.len++] = chr;
+	bgResp.buff[bgResp.len] = '\0';
+}
+
+static void bg_rx_expect(const char *prefix)
+{
+	bgExpect[0] = '\0';
+
+	if(prefix != NULL && strlen(prefix) < sizeof(bgExpect))
+		strcpy(bgExpect, prefix);
+
+	bgRxTokens &= ~BG_TOKEN_MASK(BG_TOK_EXPECTED);
+}
+
+static uint8_t bg_rx_solicited(uint8_t *line, uint16_t len)
+{
+	if(bgCmdLine[0] == '\0' || line[0] != '+') return 0;
+
+	uint8_t *colon = memchr(line, ':', len);
+	uint8_t name[20] = {'\0'};
+
+	if(colon == NULL || colon - line >= sizeof(name)) return 0;
+
+	//un resultado diferido (ej. +QIOPEN de otro socket) nunca es respuesta del comando en curso
+	int urcIdx = bg_match_urc(line, len);
+
+	if(urcIdx >= 0 && bgUrcTbl[urcIdx].deferred) return 0;
+
+	memcpy(name, line, colon - line);
+
+	return (bg_cmd_find_name(bgCmdLine, name, colon - line) != NULL) ? 1 : 0;
+}
+
+static const uint8_t *bg_cmd_find_name(const uint8_t *cmd, const uint8_t *name, uint16_t nameLen)
+{
+	uint8_t auxName[20] = {'\0'};
+
+	if(nameLen >= sizeof(auxName)) return NULL;
+
+	memcpy(auxName, name, nameLen);
+
+	//el nombre debe aparecer en el comando seguido de '=', '?', ';' o fin de comando
+	for(const uint8_t *ptr = strstr(cmd, auxName); ptr != NULL; ptr = strstr(ptr + 1, auxName))
+	{
+		uint8_t next = ptr[nameLen];
+
+		if(next == '=' || next == '?' || next == ';' || next == '\r' || next == '\0')
+			return ptr;
+	}
+
+	return NULL;
+}
+
+static void bg_no_carrier_event(void)
+{
+	bg_infoTM_t infoTM = bg_getter_transparentMode();
+
+	bgTmDataMode = 0;
+	bg_callback_closed_TM();
+	bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_SET,\
+		.connectID = infoTM.connectID};
+	bg_setter_transparentMode(valueTM);
+	LOG_BG(LE, "%sNO CARRIER URC%s\n", (infoTM.statusTM == BG_TM_ACTIVE) ? "*" : "-",\
+		(infoTM.statusTM == BG_TM_ACTIVE) ? "*" : "-");
+
+	urcRawData_t tmExitNC = {.buff = (uint8_t *)"no carrier", .len = 10, .type = BG_URC_NO_CARRIER};
+	bg_queue_put(tmExitNC);
+}
+
+static uint8_t *bg_memstr(uint8_t *buff, uint16_t len, const char *str)
+{
+	size_t strLen = strlen(str);
+
+	if(buff == NULL || strLen == 0 || strLen > len) return NULL;
+
+	for(uint16_t i = 0; i <= len - strLen; i++)
+		if(buff[i] == (uint8_t)str[0] && !memcmp(&buff[i], str, strLen))
+			return &buff[i];
+
+	return NULL;
+}
+static void bg_resp_reset(void)
+{
+	bg_rx_process();
+
+	//si hay una linea incompleta (ej. un URC a medio llegar) se conserva al inicio del buffer
+	bgResp.len -= bgRespLineStart;
+	memmove(bgResp.buff, &bgResp.buff[bgRespLineStart], bgResp.len);
+	bgResp.buff[bgResp.len] = '\0';
+	bgRespLineStart = 0;
+	bgRxTokens = 0;
+	bgRxRaw = 0;
+}
+//-----------------------------Buffer circular de recepcion end----------------------
+
+
+//-----------------------------------Motor de comandos AT-----------------------------
+static bg_err_t bg_cmd_submit(uint32_t timeout, uint8_t enablePrint, const bg_iovec_t *iov, uint8_t iovCnt,\
+	bg_cmdCallback_t callback, void *ctx, const char *fmt, va_list args)
+{
+	if(bgCmdCount >= BG_CMD_QUEUE_LEN)
+	{
+		LOG_BG(LE, "[BG_ERR] COLA DE COMANDOS LLENA\n");
+		return BG_ERR_CMD_QUEUE_FULL;
+	}
+
+	bg_cmd_t *cmd = &bgCmdQueue[(bgCmdHead + bgCmdCount) % BG_CMD_QUEUE_LEN];
+
+	//se reservan 2 bytes para "\r\n"
+	int len = vsnprintf(cmd->cmd, sizeof(cmd->cmd) - 2, fmt, args);
+
+	if(len < 0 || len >= sizeof(cmd->cmd) - 2)
+	{
+		LOG_BG(LE, "[BG_ERR] FORMATO DE COMANDO\n");
+		return BG_ERR_CMD_FORMAT;
+	}
+
+	cmd->cmd[len++] = '\r';
+	cmd->cmd[len++] = '\n';
+	cmd->cmd[len] = '\0';
+	cmd->cmdLen = len;
+	cmd->iov = (iovCnt > 0) ? iov : NULL;
+	cmd->iovCnt = iovCnt;
+	cmd->payloadLen = 0;
+
+	for(uint8_t i = 0; i < iovCnt; i++)
+		cmd->payloadLen += iov[i].len;
+
+	//un solo segmento se copia para que el llamador pueda usar una variable local
+	if(iovCnt == 1)
+	{
+		cmd->seg = iov[0];
+		cmd->iov = &cmd->seg;
+	}
+
+	cmd->timeout = timeout;
+	cmd->enablePrint = enablePrint;
+	cmd->callback = callback;
+	cmd->ctx = ctx;
+
+	bgCmdCount++;
+	return BG_OK;
+}
+
+static bg_err_t bg_cmd_run(uint32_t timeout, uint8_t enablePrint, const bg_iovec_t *iov, uint8_t iovCnt,\
+	const char *fmt, va_list args)
+{
+	bg_cmdWait_t wait = {.done = 0, .err = BG_OK};
+
+	//si la cola esta llena se atienden los comandos asincronos pendientes hasta liberar un lugar
+	while(bgCmdCount >= BG_CMD_QUEUE_LEN)
+	{
+		bg_poll();
+		bg_wait_event(bgCmdDeadline);
+	}
+
+	bg_err_t err = bg_cmd_submit(timeout, enablePrint, iov, iovCnt, bg_cmd_wait_callback, &wait, fmt, args);
+	CHECK_BG_ERR(err);
+
+	//los comandos se envian en orden, primero terminan los asincronos que ya estaban en la cola
+	while(1)
+	{
+		bg_poll();
+
+		if(wait.done) break;
+
+		bg_wait_event(bgCmdDeadline);
+	}
+
+	return wait.err;
+}
+
+static void bg_cmd_wait_callback(bg_cmdResult_t result, void *ctx)
+{
+	bg_cmdWait_t *wait = (bg_cmdWait_t *)ctx;
+
+	wait->err = result.err;
+	wait->done = 1;
+}
+
+static void bg_cmd_start(void)
+{
+	bg_cmd_t *cmd = &bgCmdQueue[bgCmdHead];
+	uint8_t *frame[] = {"************************\n", "~~~~~~~~~~~~~~~~~~~~~~~\n"};
+
+	//las lineas "+<nombre>:" de este comando se tratan como respuesta y no como URC
+	strncpy(bgCmdLine, cmd->cmd, sizeof(bgCmdLine) - 1);
+
+	bg_resp_reset();
+	bgCmeError = 0;
+
+	LOG_BG(cmd->enablePrint, "%s", (bgCmdSeq%2) ? frame[0] : frame[1]);
+	LOG_BG(cmd->enablePrint, "MCU[%ld] > \n%s\n", bgCmdSeq, cmd->cmd);
+
+	bgCmdState = BG_CMD_WAIT_ANSW;
+	bgCmdDeadline = bg_get_tick_ms() + cmd->timeout;
+
+	if(bgUartTx(cmd->cmd, cmd->cmdLen))
+	{
+		LOG_BG(cmd->enablePrint, "[BG_ERR] ERROR MCU TX UART\n");
+		bg_cmd_complete(BG_ERR_MCU_TX_UART);
+	}
+}
+
+static void bg_cmd_complete(bg_err_t err)
+{
+	bg_cmd_t *cmd = &bgCmdQueue[bgCmdHead];
+	uint8_t *frame[] = {"************************\n", "~~~~~~~~~~~~~~~~~~~~~~~\n"};
+
+	//se copia lo necesario porque el callback puede encolar otro comando en este mismo lugar
+	bg_cmdCallback_t callback = cmd->callback;
+	void *ctx = cmd->ctx;
+	uint8_t enablePrint = cmd->enablePrint;
+
+	if(err == BG_ERR_TIMEOUT_ANS)
+		LOG_BG(enablePrint, "[BG_ERR] TIMEOUT RESPUESTA BG\n");
+
+	else if(err == BG_OK)
+	{
+		//un codigo de resultado de error termina el comando con su error decodificado
+		err = bg_final_err(bgRxTokens);
+
+		LOG_BG(enablePrint, "BG[%ld] > \n", bgCmdSeq);
+		LOG_BG(enablePrint, "%s\nlen: %ld\n", &bgResp.buff[2], bgResp.len);
+	}
+
+	LOG_BG(enablePrint, "%s\n", (bgCmdSeq%2) ? frame[0] : frame[1]);
+	bgCmdSeq++;
+
+	bgCmdHead = (bgCmdHead + 1) % BG_CMD_QUEUE_LEN;
+	bgCmdCount--;
+	bgCmdState = BG_CMD_IDLE;
+
+	if(callback == NULL) return;
+
+	bg_cmdResult_t result = {.err = err, .errCode = bgCmeError, .final = BG_TOK_UNSUPPORTED, .tokens = bgRxTokens,\
+		.resp = bgResp.buff, .len = bgResp.len, .info = NULL};
+
+	for(bg_token_t tok = BG_TOK_OK; tok <= BG_TOK_CMS_ERROR; tok++)
+	{
+		if(bgRxTokens & BG_TOKEN_MASK(tok) & BG_TOKEN_FINAL_MASK)
+		{
+			//despues del prompt el resultado final es la confirmacion de envio
+			if(tok == BG_TOK_PROMPT && (bgRxTokens & BG_CMD_SEND_MASK)) continue;
+
+			result.final = tok;
+			break;
+		}
+	}
+
+	if(bgResp.len > 0 && bgResp.buff[0] == '+')
+		result.info = bgResp.buff;
+	else if((result.info = bg_memstr(bgResp.buff, bgResp.len, "\n+")) != NULL)
+		result.info++;
+
+	callback(result, ctx);
+}
+
+void bg_poll(void)
+{
+	bg_rx_process();
+
+	if(bgCmdState == BG_CMD_IDLE)
+	{
+		if(bgCmdCount > 0)
+			bg_cmd_start();
+
+		return;
+	}
+
+	bg_cmd_t *cmd = &bgCmdQueue[bgCmdHead];
+
+	if(bgCmdState == BG_CMD_WAIT_ANSW && cmd->iov != NULL && (bgRxTokens & BG_TOKEN_MASK(BG_TOK_PROMPT)))
+	{
+		LOG_BG(cmd->enablePrint, "MCU[%ld] > %d bytes\n", bgCmdSeq, cmd->payloadLen);
+
+		bgCmdState = BG_CMD_WAIT_SEND;
+		bgCmdDeadline = bg_get_tick_ms() + cmd->timeout;
+
+		bg_err_t errTx = BG_OK;
+
+		//los segmentos salen seguidos, el modulo espera payloadLen bytes sin importar como se partieron
+		if(bgUartTxv != NULL && cmd->iovCnt > 1)
+			errTx = bgUartTxv(cmd->iov, cmd->iovCnt);
+
+		else
+			for(uint8_t i = 0; i < cmd->iovCnt && errTx == BG_OK; i++)
+				errTx = bgUartTx((uint8_t *)cmd->iov[i].base, cmd->iov[i].len);
+
+		if(errTx)
+		{
+			LOG_BG(cmd->enablePrint, "[BG_ERR] ERROR MCU TX UART\n");
+			bg_cmd_complete(BG_ERR_MCU_TX_UART);
+		}
+
+		return;
+	}
+
+	if(bgRxTokens & ((bgCmdState == BG_CMD_WAIT_SEND) ? BG_CMD_SEND_MASK : BG_TOKEN_FINAL_MASK))
+		bg_cmd_complete(BG_OK);
+
+	else if(BG_DEADLINE_REACHED(bg_get_tick_ms(), bgCmdDeadline))
+		bg_cmd_complete(BG_ERR_TIMEOUT_ANS);
+}
+
+uint8_t bg_cmd_pending(void)
+{
+	return bgCmdCount;
+}
+
+static bg_err_t bg_final_err(uint32_t tokens)
+{
+	if(tokens & BG_TOKEN_MASK(BG_TOK_CME_ERROR)) return BG_ERR_CME;
+
+	if(tokens & BG_TOKEN_MASK(BG_TOK_CMS_ERROR)) return BG_ERR_CMS;
+
+	if(tokens & BG_TOKEN_MASK(BG_TOK_SEND_FAIL)) return BG_ERR_SEND_FAIL;
+
+	if(tokens & BG_TOKEN_MASK(BG_TOK_ERROR)) return BG_ERR_AT;
+
+	return BG_OK;
+}
+
+uint16_t bg_get_cme_error(void)
+{
+	return bgCmeError;
+}
+
+bg_err_t bg_send_async(uint32_t timeout, bg_cmdCallback_t callback, void *ctx, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	bg_err_t err = bg_cmd_submit(timeout, LE, NULL, 0, callback, ctx, fmt, args);
+	va_end(args);
+
+	return err;
+}
+
+bg_err_t bg_send_data_async(uint32_t timeout, const uint8_t *data, uint16_t len, bg_cmdCallback_t callback, void *ctx,\
+	const char *fmt, ...)
+{
+	if(data == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	bg_iovec_t seg = {.base = data, .len = len};
+
+	va_list args;
+	va_start(args, fmt);
+	bg_err_t err = bg_cmd_submit(timeout, LE, &seg, 1, callback, ctx, fmt, args);
+	va_end(args);
+
+	return err;
+}
+
+static bg_err_t bg_send_data(uint32_t timeout, uint8_t enablePrint, const bg_iovec_t *iov, uint8_t iovCnt,\
+	const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	bg_err_t err = bg_cmd_run(timeout, enablePrint, iov, iovCnt, fmt, args);
+	va_end(args);
+
+	return err;
+}
+
+bg_err_t bg_send_batch(bg_batchCmd_t *batch, uint8_t nCmds)
+{
+	if(batch == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	bg_err_t errBatch = BG_OK;
+	uint8_t i = 0;
+
+	for(uint8_t k = 0; k < nCmds; k++)
+	{
+		batch[k].done = 0;
+		batch[k].err = BG_ERR_TIMEOUT_ANS;
+		if(batch[k].resp != NULL && batch[k].respSize > 0) batch[k].resp[0] = '\0';
+	}
+
+	while(i < nCmds)
+	{
+		uint8_t j;
+		bg_err_t err;
+
+		//un comando concatenable sin vecino concatenable tambien se envia solo
+		if(!batch[i].concat || i + 1 >= nCmds || !batch[i + 1].concat)
+		{
+			//tramo de comandos que se envian solos (uno tras otro en el motor de comandos)
+			for(j = i + 1; j < nCmds && !(batch[j].concat && j + 1 < nCmds && batch[j + 1].concat); j++);
+
+			err = bg_batch_pipeline(&batch[i], j - i);
+		}
+
+		else
+		{
+			//tramo concatenado: "AT+CMD1;+CMD2;..." mientras quepa en BG_CMD_MAX_LEN
+			uint8_t line[BG_CMD_MAX_LEN] = "AT";
+			size_t lineLen = 2;
+			uint32_t timeout = 0;
+
+			for(j = i; j < nCmds && batch[j].concat; j++)
+			{
+				const char *body = batch[j].cmd;
+
+				if(!strncmp(body, "AT", 2) || !strncmp(body, "at", 2)) body += 2;
+
+				//se reservan 3 bytes para ';' y "\r\n"
+				if(lineLen + strlen(body) + 3 >= sizeof(line)) break;
+
+				if(j > i) line[lineLen++] = ';';
+
+				strcpy(&line[lineLen], body);
+				lineLen += strlen(body);
+				timeout += batch[j].timeout;
+			}
+
+			if(j == i) j = i + 1; //el comando no cabe en la linea, se envia solo
+
+			if(j == i + 1)
+				err = bg_batch_pipeline(&batch[i], 1);
+
+			else
+			{
+				err = bg_send(timeout, LE, "%s", line);
+
+				if(err == BG_OK)
+				{
+					bg_batch_split(&batch[i], j - i);
+				}
+
+				//el modulo se detiene en el comando que fallo, se repiten uno por uno para conocer cada resultado
+				else if(BG_IS_AT_ERR(err))
+				{
+					LOG_BG(LE, "[BG_ERR] LINEA CONCATENADA CON ERROR, SE ENVIAN LOS COMANDOS UNO POR UNO\n");
+					err = bg_batch_pipeline(&batch[i], j - i);
+				}
+
+				else
+				{
+					for(uint8_t k = i; k < j; k++)
+						batch[k].err = err;
+				}
+			}
+		}
+
+		if(errBatch == BG_OK) errBatch = err;
+
+		//sin respuesta del modulo no tiene caso seguir con el lote
+		if(err != BG_OK && !BG_IS_AT_ERR(err)) return err;
+
+		i = j;
+	}
+
+	return errBatch;
+}
+
+static bg_err_t bg_batch_pipeline(bg_batchCmd_t *batch, uint8_t nCmds)
+{
+	uint8_t sent = 0, done = 0;
+
+	//se encolan todos los comandos que quepan, el motor los envia sin esperas entre ellos
+	while(done < nCmds)
+	{
+		while(sent < nCmds && bg_cmd_pending() < BG_CMD_QUEUE_LEN)
+		{
+			bg_err_t err = bg_send_async(batch[sent].timeout, bg_batch_callback, &batch[sent], "%s", batch[sent].cmd);
+
+			if(err != BG_OK)
+			{
+				batch[sent].err = err;
+				batch[sent].done = 1;
+			}
+
+			sent++;
+		}
+
+		bg_poll();
+
+		for(done = 0; done < nCmds && batch[done].done; done++);
+
+		if(done < nCmds)
+			bg_wait_event(bgCmdDeadline);
+	}
+
+	for(uint8_t k = 0; k < nCmds; k++)
+	{
+		if(batch[k].err != BG_OK)
+			return batch[k].err;
+	}
+
+	return BG_OK;
+}
+
+static void bg_batch_callback(bg_cmdResult_t result, void *ctx)
+{
+	bg_batchCmd_t *cmd = (bg_batchCmd_t *)ctx;
+
+	cmd->err = result.err;
+	cmd->done = 1;
+
+	if(cmd->resp == NULL || cmd->respSize == 0) return;
+
+	uint16_t len = (result.len < cmd->respSize) ? result.len : cmd->respSize - 1;
+	memcpy(cmd->resp, result.resp, len);
+	cmd->resp[len] = '\0';
+}
+
+static void bg_batch_split(bg_batchCmd_t *batch, uint8_t nCmds)
+{
+	uint8_t cursor = 0, cursorHasLine = 0;
+	uint8_t *line = bgResp.buff;
+	uint8_t *end = &bgResp.buff[bgResp.len];
+
+	for(uint8_t k = 0; k < nCmds; k++)
+	{
+		batch[k].err = BG_OK;
+		batch[k].done = 1;
+	}
+
+	while(line < end)
+	{
+		uint8_t *eol = memchr(line, '\n', end - line);
+		uint16_t lineLen = (eol != NULL) ? eol - line + 1 : end - line;
+		uint8_t *colon = memchr(line, ':', lineLen);
+
+		//las respuestas llegan en el orden de los comandos, se busca desde el ultimo comando con respuesta
+		if(line[0] == '+' && colon != NULL)
+		{
+			for(uint8_t k = cursor; k < nCmds; k++)
+			{
+				if(bg_cmd_find_name(batch[k].cmd, line, colon - line) == NULL) continue;
+
+				//si mas adelante hay otro comando con el mismo nombre (ej. varios AT+QCFG="...") la siguiente
+				//linea es de ese comando
+				if(k == cursor && cursorHasLine)
+				{
+					uint8_t next = k + 1;
+
+					while(next < nCmds && bg_cmd_find_name(batch[next].cmd, line, colon - line) == NULL) next++;
+
+					if(next < nCmds) k = next;
+				}
+
+				cursor = k;
+				cursorHasLine = 1;
+
+				if(batch[k].resp != NULL && batch[k].respSize > 0)
+				{
+					size_t used = strlen(batch[k].resp);
+					size_t len = (used + lineLen < batch[k].respSize) ? lineLen : batch[k].respSize - 1 - used;
+
+					memcpy(&batch[k].resp[used], line, len);
+					batch[k].resp[used + len] = '\0';
+				}
+
+				break;
+			}
+		}
+
+		line += lineLen;
+	}
+}
+
+static uint8_t *bg_strcasestr(uint8_t *str, const char *sub)
+{
+	size_t subLen = strlen(sub);
+
+	for(; *str != '\0'; str++)
+	{
+		size_t i = 0;
+
+		while(i < subLen && str[i] != '\0' && tolower(str[i]) == tolower((uint8_t)sub[i])) i++;
+
+		if(i == subLen) return str;
+	}
+
+	return NULL;
+}
+//-----------------------------------Motor de comandos AT end-------------------------
+
+
+//------------------Funciones basicas y de configuracion de modulo------------------
+bg_err_t bg_send(uint32_t timeout, uint8_t enablePrint, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	bg_err_t err = bg_cmd_run(timeout, enablePrint, NULL, 0, fmt, args);
+	va_end(args);
+
+	return err;
+}
+
+static bg_err_t bg_boot_probe(uint8_t tries)
+{
+	bg_err_t err = BG_ERR_TIMEOUT_ANS;
+
+	for(uint8_t i = 0; i < tries && err != BG_OK; i++)
+		err = bg_send(BG_TIMEOUT_QUICK, LD, "AT");
+
+	return err;
+}
+
+static bg_err_t bg_boot_wait_ready(uint32_t timeout)
+{
+	uint32_t deadline = bg_get_tick_ms() + timeout;
+
+	while((bg_rx_process(), !(bgRxTokens & BG_TOKEN_MASK(BG_TOK_RDY))) &&\
+		!(bgStatusRead != NULL && bgStatusRead()) && !BG_DEADLINE_REACHED(bg_get_tick_ms(), deadline))
+		bg_wait_event(deadline);
+
+	if(bgRxTokens & BG_TOKEN_MASK(BG_TOK_RDY))
+		return BG_OK;
+
+	if(bgStatusRead != NULL && bgStatusRead())
+		return BG_OK;
+
+	LOG_BG(LE,"[BG_ERR] TIMEOUT ARRANQUE DEL MODULO (RDY/STATUS)\n");
+	return BG_ERR_TIMEOUT_ANS_DESIRED;
+}
+
+bg_err_t bg_power_on(void)
+{
+	bg_err_t err = bg_boot_probe(BG_BOOT_PROBE_TRIES);
+
+	if(err == BG_OK)
+	{
+		LOG_BG(LD,"[BG_LOG] MODULO YA ENCENDIDO\n");
+		return BG_OK;
+	}
+
+	bg_resp_reset();
+	bg_module_state_reset();
+
+	//Con STATUS activo el modulo esta encendido pero no contesta (ej. en modo transparente), un pulso de
+	//PWRKEY lo apagaria, por eso se reinicia con RESET_N
+	if(bgStatusRead != NULL && bgStatusRead())
+	{
+		bgGpioWrite(BG_RESET_PIN, 1);
+		bgDelay(BG_RESET_PULSE_MS);
+		bgGpioWrite(BG_RESET_PIN, 0);
+	}
+	else
+	{
+		bgGpioWrite(BG_PWRKEY_PIN, 1);
+		bgDelay(BG_PWRKEY_PULSE_MS);
+		bgGpioWrite(BG_PWRKEY_PIN, 0);
+	}
+
+	err = bg_boot_wait_ready(BG_BOOT_TIMEOUT);
+	CHECK_BG_ERR(err);
+
+	//Despues de RDY el modulo contesta de inmediato, con STATUS puede tardar un poco mas en aceptar comandos
+	return bg_boot_probe((bgRxTokens & BG_TOKEN_MASK(BG_TOK_RDY)) ? BG_BOOT_PROBE_TRIES : BG_BOOT_TIMEOUT / BG_TIMEOUT_QUICK);
+}
+
+bg_err_t bg_power_off(void)
+{
+	bg_err_t err = BG_OK;
+
+	bgDelay(500); //1000 1s
+	
+	err = bg_send(5000, LE, "AT+QPOWD");
+	CHECK_BG_ERR(err);
+
+	bg_module_state_reset();
+
+	CHECK_POWDWN_ANSW(BG_TIMEOUT_ANSW_OK);
+
+	//Sin pin STATUS se espera el tiempo minimo antes de volver a encender o cortar VBAT
+	if(bgStatusRead == NULL)
+	{
+		bgDelay(3000);
+		return BG_OK;
+	}
+
+	uint32_t deadline = bg_get_tick_ms() + BG_BOOT_TIMEOUT;
+	while(bgStatusRead() && !BG_DEADLINE_REACHED(bg_get_tick_ms(), deadline))
+		bg_wait_event(deadline);
+
+	return BG_OK;
+}
+
+static void bg_module_state_reset(void)
+{
+	//el modulo se reinicia y pierde la configuracion de modo transparente, los sockets y los contextos PDP
+	bgTmWaitTimeModule = BG_TM_CFG_UNKNOWN;
+	bgTmDataMode = 0;
+	bgRxPush = 0;
+	bgConnectIDMap = 0;
+	memset(bgPool, 0, sizeof(bgPool));
+	memset(bgScktTbl, 0, sizeof(bgScktTbl));
+	memset(bgPdpTbl, 0, sizeof(bgPdpTbl));
+}
+
+static bg_err_t bg_config_module(void){
+
+	static uint8_t configDone = 0;
+
+	if(configDone)
+		return BG_OK;
+
+	bg_err_t err = bg_apply_config(bgCfgProfile, sizeof(bgCfgProfile) / sizeof(bgCfgProfile[0]));
+	CHECK_BG_ERR(err);
+
+	configDone = 1;
+
+	return BG_OK;
+}
+
+bg_err_t bg_apply_config(const bg_cfgItem_t *profile, uint8_t nItems)
+{
+	static bg_batchCmd_t batch[BG_CFG_MAX_ITEMS + 1];
+	static uint8_t resp[BG_CFG_MAX_ITEMS][BG_CFG_RESP_LEN];
+	uint8_t idx[BG_CFG_MAX_ITEMS];
+	uint8_t update[BG_CFG_MAX_ITEMS] = {0};
+	uint8_t nQuery = 0, nSet = 0, persist = 0;
+	bg_err_t err;
+
+	if(profile == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	if(nItems > BG_CFG_MAX_ITEMS) return BG_ERR_CFG_PROFILE;
+
+	//lectura de los valores actuales, los comandos extendidos se concatenan en una sola linea
+	for(uint8_t i = 0; i < nItems; i++)
+	{
+		if(profile[i].query == NULL || profile[i].expect == NULL)
+		{
+			update[i] = 1;
+			continue;
+		}
+
+		batch[nQuery] = (bg_batchCmd_t){.cmd = profile[i].query, .timeout = BG_TIMEOUT_QUICK,\
+			.concat = (profile[i].query[2] == '+'), .resp = resp[nQuery], .respSize = sizeof(resp[0])};
+		idx[nQuery++] = i;
+	}
+
+	if(nQuery > 0)
+	{
+		err = bg_send_batch(batch, nQuery);
+
+		if(!BG_IS_AT_ERR(err))
+			CHECK_BG_ERR(err);
+
+		for(uint8_t q = 0; q < nQuery; q++)
+		{
+			if(batch[q].err != BG_OK || bg_strcasestr(resp[q], profile[idx[q]].expect) == NULL)
+				update[idx[q]] = 1;
+		}
+	}
+
+	//solo se envian los parametros que no tienen el valor deseado
+	for(uint8_t i = 0; i < nItems; i++)
+	{
+		if(!update[i]) continue;
+
+		batch[nSet++] = (bg_batchCmd_t){.cmd = profile[i].set, .timeout = BG_TIMEOUT_QUICK,\
+			.concat = (profile[i].set[2] == '+'), .resp = NULL, .respSize = 0};
+
+		if(profile[i].persist && profile[i].query != NULL)
+			persist = 1;
+	}
+
+	//AT&W0 solo si cambio algun parametro que se guarda en NV con AT&W
+	if(persist)
+		batch[nSet++] = (bg_batchCmd_t){.cmd = "AT&W0", .timeout = 5000, .concat = 0, .resp = NULL, .respSize = 0};
+
+	LOG_BG(LE, "CONFIGURACION: %d DE %d PARAMETROS A ESTABLECER%s\n", nSet - persist, nItems, persist ? " + AT&W0" : "");
+
+	if(nSet == 0) return BG_OK;
+
+	err = bg_send_batch(batch, nSet);
+
+	//un parametro no soportado por el firmware no detiene el resto de la configuracion
+	if(!BG_IS_AT_ERR(err))
+		CHECK_BG_ERR(err);
+
+	for(uint8_t k = 0; k < nSet; k++)
+	{
+		if(batch[k].err != BG_OK)
+			LOG_BG(LE, "[BG_ERR] CONFIGURACION NO ACEPTADA: %s (%d)\n", batch[k].cmd, batch[k].err);
+	}
+
+	return BG_OK;
+}
+
+bg_err_t bg_init_module(void)
+{	
+	uint8_t attmp = 0;
+	
+	if(bgModuleInit) return BG_OK;
+
+	//DTR en ON, con AT&D1 el flanco ON->OFF saca al modulo de modo transparente
+	if(bgDtrPin)
+		bgGpioWrite(BG_DTR_PIN, 1);
+
+	while(bg_power_on() != BG_OK)
+	{
+		printf("POWER ON... ATTEMP: %d\n", ++attmp);
+		if(attmp >= BG_POWER_ON_ATTEMPTS)
+		  bgResetMCU();
+	}
+
+	printf("|--- POWER ON... OK ---|\n\n");
+
+	bg_err_t err = bg_config_module();
+	CHECK_BG_ERR(err);
+
+	if(bgDtrPin)
+	{
+		err = bg_send(BG_TIMEOUT_QUICK, LE, "AT&D1");
+		CHECK_BG_ERR(err);
+	}
+
+	err = bg_send(10000, LE, "AT+QRFTESTMODE=0");
+	CHECK_BG_ERR(err);
+
+	bgModuleInit = 1;
+
+	return BG_OK;
+}
+//------------------Funciones basicas y de configuracion de modulo------------------
+
+
+//---------------------------------Funciones de consulta-----------------------------
+bg_err_t bg_data_module(void)
+{
+	uint8_t FW[50] = {'\0'}, ICCID[50] = {'\0'}, IMEI[50] = {'\0'};
+	uint8_t *dataPtr[] = {FW, ICCID, IMEI};	
+	size_t sizeBuff[] = {sizeof(FW), sizeof(ICCID), sizeof(IMEI)};
+	uint8_t resp[3][80];
+
+	//AT+GMR y AT+GSN no responden con "+<nombre>:", se envian uno tras otro sin concatenar
+	bg_batchCmd_t query[] = {
+		{.cmd = "AT+GMR", .timeout = BG_TIMEOUT_QUICK, .concat = 0, .resp = resp[0], .respSize = sizeof(resp[0])},//Consulta el Fw del modulo
+		{.cmd = "AT+QCCID", .timeout = BG_TIMEOUT_QUICK, .concat = 0, .resp = resp[1], .respSize = sizeof(resp[1])},//Consulta del ICCID del SIM
+		{.cmd = "AT+GSN", .timeout = BG_TIMEOUT_QUICK, .concat = 0, .resp = resp[2], .respSize = sizeof(resp[2])}//Consulta IMEI
+	};
+
+	uint8_t chrDelim[] = {'\n', ' ', '\n'};
+
+	bg_err_t err = bg_send_batch(query, sizeof(query) / sizeof(query[0]));
+	CHECK_BG_ERR(err);
+
+	for(int i = 0; i < sizeof(query) / sizeof(query[0]); i++)
+		COPY_PARSE_STR(dataPtr[i], sizeBuff[i], query[i].resp, chrDelim[i], '\n');
+
+	LOG_BG(LE, "FW: %s\nICCID: %s\nIMEI: %s\n", FW, ICCID, IMEI);
+
+	return err;
+}
+
+bg_err_t bg_check_sim(void)
+{
+	bg_err_t err;
+
+	for(size_t attmp = 0; attmp <= 3; attmp++)
+	{
+		if(attmp >= 3) return BG_ERR_SIM_NO_OK;
+
+		err = bg_send(5000, LE, "AT+CPIN?");
+
+		//sin SIM el modulo responde +CME ERROR: 10
+		if(BG_IS_AT_ERR(err)) continue;
+
+		CHECK_BG_ERR(err);
+
+		if(strstr(bgResp.buff, "READY")) break;
+	}
+
+	return BG_OK_SIM;
+}
+
+bg_err_t bg_check_attach(void)
+{
+	bg_err_t err = bg_send(10000, LE, "AT+CEREG?");
+	CHECK_BG_ERR(err);
+
+	uint8_t *parsePtr = strchr(bgResp.buff, ',');
+
+	if(parsePtr == NULL) return BG_ERR_PARSE;
+
+	if(*(parsePtr + 1) == '5' || *(parsePtr + 1) == '1') return BG_OK_ATTACH; //registrado 1 o 5 +CEREG: 0,5,
+
+	return BG_ERR_ATTACH_NO_OK;
+}
+
+bg_err_t bg_query_cops(void)
+{
+	bg_err_t err = bg_send(10000, LE, "AT+COPS?");
+	CHECK_BG_ERR(err);
+
+	uint8_t *parsePtr = bgResp.buff;
+
+	if(strchr(parsePtr, ',') == NULL) return BG_ERR_NO_OPER;
+
+	uint8_t mode[10] = {'\0'}, oper[20] = {'\0'}, accessTech[10] = {'\0'};
+	uint8_t *dataBuff[] = {mode, NULL, oper, accessTech};
+	size_t sizeBuff[] = {sizeof(mode), 0, sizeof(oper), sizeof(accessTech)};
+	uint8_t chrDelim1[] = {' ', ',', ',', ','};
+	uint8_t chrDelim2[] = {',', ',', ',', '\n'};
+
+	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+	{
+		parsePtr = strchr(parsePtr, chrDelim1[i]);
+		if(parsePtr)
+		{
+			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
+			parsePtr++;
+		}
+	}
+	
+	uint8_t *strMode[] = {"Auto", "Manual", "Desregistrado Manual", "", "Manual-Auto"},\
+			*strAccss[] = {"GSM", "", "", "", "", "", "", "E-ULTRAN", "eMTC", "MB-IoT"};
+
+	printf("mode: %s\noper: %s\naccss: %s\n", strMode[atoi(mode)], oper,\
+			strAccss[atoi(accessTech)]);
+
+	return BG_OK;
+}
+
+bg_err_t bg_query_conf_pdp(uint8_t contextID)
+{
+	if(contextID > BG_CONTEXT_ID_MAX || contextID < BG_CONTEXT_ID_MIN)
+		return BG_ERR_CTXT_ID_UNSUPPORTED;
+
+	bg_err_t err = bg_send(40000, LD, "AT+QICSGP=%d", contextID);
+	CHECK_BG_ERR(err);
+
+	uint8_t *parsePtr = bgResp.buff;
+
+	if(strchr(parsePtr, ',') == NULL) return BG_ERR_NO_OPER;
+
+	uint8_t apn[256] = {'\0'}, usr[100] = {'\0'}, passw[100] = {'\0'}, auth[100] = {'\0'};
+	uint8_t *dataBuff[] = {apn, usr, passw, auth};
+	size_t sizeBuff[] = {sizeof(apn), sizeof(usr), sizeof(passw), sizeof(auth)};
+	uint8_t chrDelim1[] = {',', ',', ',', ','};
+	uint8_t chrDelim2[] = {',', ',', ',', '\n'};
+
+	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+	{
+		parsePtr = strchr(parsePtr, ',');
+		
+		if(parsePtr)
+		{
+			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
+			parsePtr++;
+		}
+	}
+	
+	LOG_BG(LE, "APN: %s\nUser: %s\nPassword: %s\nAuth: %s\n", apn, usr, passw, auth);
+
+	return BG_OK;
+}
+
+bg_err_t bg_check_pdp(uint8_t ctxtID)
+{
+	if(ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN) return BG_ERR_CTXT_ID_UNSUPPORTED;
+	bg_err_t err = bg_send(10000, LD, "AT+QIACT?");
+	CHECK_BG_ERR(err);
+
+	bg_pdp_parse_qiact(bgResp.buff);
+
+	const bg_pdpInfo_t *pdp = &bgPdpTbl[ctxtID - BG_CONTEXT_ID_MIN];
+	uint8_t *strCtxtState[] = {"Desactivado", "Activado"},\
+		*strCtxtType[] = {"", "IPv4", "IPv6", "IPv4v6"};
+
+	LOG_BG(LE, "ctxState: %s\nctxtType: %s\nip: %s\n", strCtxtState[pdp->active],\
+		strCtxtType[(pdp->ctxtType < BG_CTXT_UNSUPPORTED) ? pdp->ctxtType : 0], pdp->ip);
+
+	if(!pdp->active) return BG_OK_PDP_DEACT;
+
+	return BG_OK_PDP_ACT;
+}
+
+bg_err_t bg_check_sckt(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+	bg_err_t err = bg_send(10000, LD, "AT+QISTATE=1,%d", connectID);
+	CHECK_BG_ERR(err);
+
+	//sin linea +QISTATE el connectID no esta en uso
+	uint8_t *parsePtr = strstr(bgResp.buff, "+QISTATE: ");
+
+	if(parsePtr == NULL || bg_sckt_parse_qistate(parsePtr) != connectID)
+	{
+		bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+		return BG_OK_CONNECT_ID_CLOSED;
+	}
+
+	const bg_scktInfo_t *info = &bgScktTbl[connectID];
+	LOG_BG(LD, "connectID: %d service: %d ip: %s remotePort: %lu localPort: %lu state: %d\n", connectID,\
+		info->service, info->ip, info->remotePort, info->localPort, info->state);
+
+	if(info->state == BG_SCKT_STATE_INITIAL || info->state == BG_SCKT_STATE_CLOSING) return BG_OK_CONNECT_ID_CLOSED; 
+
+	return BG_OK_CONNECT_ID_OPENNED;
+}
+
+bg_err_t bg_query_signal(void)
+{
+	bg_err_t err = bg_send(10000, LE, "AT+QCSQ");
+	CHECK_BG_ERR(err);
+
+	uint8_t *parsePtr = bgResp.buff;
+
+	uint8_t sysMode[20] = {'\0'}, rssi[30] = {'\0'}, rsrp[10] = {'\0'}, sinr[10] = {'\0'},\
+			rsrq[10] = {'\0'};
+	uint8_t *dataBuff[] = {sysMode, rssi, rsrp, sinr, rsrq};
+	size_t sizeBuff[] = {sizeof(sysMode), sizeof(rssi), sizeof(rsrp),\
+			sizeof(sinr), sizeof(rsrq)};
+	uint8_t chrDelim1[] = {' ', ',', ',', ',',','};
+	uint8_t chrDelim2[] = {',', ',', ',', ',','\n'};
+
+	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+	{
+		parsePtr = strchr(parsePtr, chrDelim1[i]);
+		
+		if(parsePtr)
+		{
+			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
+			parsePtr++;
+		}
+	}
+
+	int rssi_int = atoi(rssi);
+	int rsrp_int = atoi(rsrp);
+
+	float sinr_f = (float) atoi(sinr);
+	sinr_f /= 2;
+	sinr_f -= 23.5;
+	int sinr_int = sinr_f;
+
+	int rsrq_int = atoi(rsrq);
+
+
+	printf("SysMode: %s\nRSSI: %ld\nRSRP: %ld\nSINR: %ld\nRSRQ: %ld\n", sysMode,\
+		rssi_int, rsrp_int, sinr_int, rsrq_int);
+
+	//if(rsrp_int >= -115 && rsrq_int >= -15 && sinr_int >= 0)
+	if(rsrp_int >= -115 && sinr_int >= 0)
+		return BG_OK_SIGNAL;
+
+	return BG_ERR_SIGNAL;
+}
+//---------------------------------Funciones de consulta end-------------------------
+
+
+//-------------------------Funciones de Attach y activacion PDP----------------------
+bg_err_t bg_attach(uint8_t *operator)
+{
+	bg_err_t err = BG_ERR_ATTACH_NO_OK;
+	for(int i = 0; i <= 3; i++)
+	{
+		if(i == 3) return err;
+  
+		if((err = bg_send(180000, LE, "AT+COPS=4,2,\"%s\",8", operator)) != BG_OK) continue;//intenta registrarse en la red de un operador para EG915ULA el Act (access technology es 7 E-ULTRAN)
+		
+		if(bg_check_attach() == BG_OK_ATTACH) break;
+
+		err = BG_ERR_ATTACH_NO_OK;
+	}
+
+	return BG_OK_ATTACH;
+}
+
+bg_err_t bg_conf_pdp(bg_ctxPdp_t contextPDP)
+{
+	if(contextPDP.ctxtID > BG_CONTEXT_ID_MAX || contextPDP.ctxtID < BG_CONTEXT_ID_MIN)
+	 return BG_ERR_CTXT_ID_UNSUPPORTED;
+
+	bg_err_t err = bg_send(40000, LE, "AT+QICSGP=%d,%d,\"%s\",\"%s\",\"%s\",%d",contextPDP.ctxtID,\
+		contextPDP.contextType, contextPDP.apn, contextPDP.usr, contextPDP.psw, contextPDP.auth);
+
+	CHECK_BG_ERR(err);
+
+	if(strstr(bgResp.buff, "OK")) return BG_OK_CONF_PDP;
+
+	return BG_ERR_CONF_PDP;
+}
+
+bg_err_t bg_pdp_activation(uint8_t ctxtID, bg_actPdp_t act)
+{
+	if(ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN) 
+	return BG_ERR_CTXT_ID_UNSUPPORTED;
+
+	if(act > BG_PDP_ACT_UNSUPORTED) return BG_ERR_ACT_PDP;
+
+	uint8_t *atCmd[] = {"AT+QIACT=", "AT+QIDEACT="};
+
+	bg_err_t err = bg_send(30000, LE, "%s%d", atCmd[act], ctxtID);
+
+	//AT+QIACT responde ERROR si el contexto ya estaba activo, el estado real se consulta con AT+QIACT?
+	if(!BG_IS_AT_ERR(err))
+		CHECK_BG_ERR(err);
+
+	return bg_check_pdp(ctxtID);
+}
+//-------------------------Funciones de Attach y activacion PDP end------------------
+
+
+//------------------------Funciones de apertura de socket---------------------------
+bg_err_t bg_open_sckt(bgSckt_t sckt)
+{
+	uint8_t openAnsw[20] = {'\0'};
+	const uint8_t *cmd = bg_qiopen_cmd(&sckt);
+
+	if(cmd == NULL) return BG_ERR_OPEN_SCKT;
+
+	//el resultado llega despues del OK, se registra antes de enviar el comando para no perderlo
+	sprintf(openAnsw, "+QIOPEN: %d,", sckt.connectID);
+	bg_rx_expect(openAnsw);
+	bg_sckt_opening(&sckt);
+
+	bg_err_t err = bg_send(BG_OPEN_TIMEOUT, LE, "%s", cmd);
+
+	if(err != BG_OK)
+	{
+		bg_rx_expect(NULL);
+		bg_sckt_set_state(sckt.connectID, BG_SCKT_STATE_INITIAL);
+	}
+	CHECK_BG_ERR(err);
+
+	CHECK_OPEN_SCKT(BG_OPEN_TIMEOUT);
+
+	//+QIOPEN: <connectID>,<err>
+	uint8_t *parsePtr = NULL;
+
+	if(bgRxTokens & BG_TOKEN_MASK(BG_TOK_EXPECTED))
+		parsePtr = strchr(&bgResp.buff[bgExpectPos], ',');
+
+	bg_rx_expect(NULL);
+
+	//sin resultado el socket queda en OPENING, el +QIOPEN puede llegar despues como URC
+	if(parsePtr == NULL)
+		return BG_ERR_OPEN_SCKT;
+
+	bg_sckt_open_result(sckt.connectID, atoi(parsePtr + 1));
+
+	//la tabla ya tiene los parametros del socket, no se consulta AT+QISTATE
+	if(bgScktTbl[sckt.connectID].state == BG_SCKT_STATE_INITIAL)
+		return BG_ERR_OPEN_SCKT;
+
+	return BG_OK_CONNECT_ID_OPENNED;
+}
+
+bg_err_t bg_open_sckt_async(const bgSckt_t *sckt, bg_openCallback_t callback, void *ctx)
+{
+	if(sckt == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	if(sckt->connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	if(bgOpenPend[sckt->connectID].active) return BG_ERR_OPEN_SCKT;
+
+	const uint8_t *cmd = bg_qiopen_cmd(sckt);
+
+	if(cmd == NULL) return BG_ERR_OPEN_SCKT;
+
+	bg_err_t err = bg_send_async(BG_OPEN_TIMEOUT, bg_open_async_callback, (void *)(uintptr_t)sckt->connectID, "%s", cmd);
+	CHECK_BG_ERR(err);
+
+	//el +QIOPEN es un URC diferido, se procesa en bg_handle_urc() con el socket en OPENING
+	bg_sckt_opening(sckt);
+
+	bgOpenPend[sckt->connectID] = (bg_openPend_t){.active = 1, .callback = callback, .ctx = ctx,\
+		.deadline = bg_get_tick_ms() + BG_OPEN_TIMEOUT};
+
+	return BG_OK;
+}
+
+bg_err_t bg_open_sckts(const bgSckt_t *sckt, uint8_t n, bg_err_t *result)
+{
+	if(sckt == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	bg_err_t res[BG_CONNECT_ID_MAX + 1];
+	uint8_t next = 0, pending = 0;
+
+	if(n > BG_CONNECT_ID_MAX + 1) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	for(uint8_t i = 0; i < n; i++)
+		res[i] = BG_ERR_OPEN_SCKT;
+
+	uint32_t t0 = bg_get_tick_ms();
+
+	//las aperturas se encolan mientras haya lugar en la cola de comandos, las demas cuando se libere
+	while(next < n || pending > 0)
+	{
+		while(next < n)
+		{
+			bg_err_t err = bg_open_sckt_async(&sckt[next], bg_open_wait_callback, &res[next]);
+
+			if(err == BG_ERR_CMD_QUEUE_FULL) break;
+
+			if(err == BG_OK)
+				pending++;
+			else
+				res[next] = err;
+
+			next++;
+		}
+
+		//solo se atienden la cola de comandos y los +QIOPEN, los demas URC quedan para bg_handle_urc(void)
+		bg_poll();
+		bg_open_poll();
+
+		pending = 0;
+		for(uint8_t i = 0; i < next; i++)
+			if(bgOpenPend[sckt[i].connectID].active && bgOpenPend[sckt[i].connectID].ctx == &res[i])
+				pending++;
+
+		if(pending > 0 || next < n)
+			bg_wait_event(bg_get_tick_ms() + BG_WAIT_EVENT_MAX_MS);
+	}
+
+	LOG_BG(LE, "[BG_LOG] APERTURA DE %d SOCKETS EN %lu ms\n", n, bg_get_tick_ms() - t0);
+
+	bg_err_t err = BG_OK_CONNECT_ID_OPENNED;
+
+	for(uint8_t i = 0; i < n; i++)
+	{
+		if(result != NULL)
+			result[i] = res[i];
+
+		if(err == BG_OK_CONNECT_ID_OPENNED && res[i] != BG_OK_CONNECT_ID_OPENNED)
+			err = res[i];
+	}
+
+	return err;
+}
+
+static void bg_open_async_callback(bg_cmdResult_t result, void *ctx)
+{
+	uint8_t connectID = (uint8_t)(uintptr_t)ctx;
+
+	//con el AT+QICLOSE del timeout en curso la apertura la termina bg_open_close_callback()
+	if(result.err == BG_OK || bgOpenPend[connectID].closing)
+		return;
+
+	LOG_BG(LE, "[BG_ERR] AT+QIOPEN RECHAZADO connectID: %d err: %d\n", connectID, result.err);
+
+	if(bgScktTbl[connectID].state == BG_SCKT_STATE_OPENING)
+		bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+
+	bg_open_done(connectID, result.err);
+}
+
+static void bg_open_done(uint8_t connectID, bg_err_t err)
+{
+	bg_openPend_t *pend = &bgOpenPend[connectID];
+
+	if(!pend->active) return;
+
+	//se libera antes del callback para que pueda volver a abrir el connectID
+	bg_openCallback_t callback = pend->callback;
+	void *ctx = pend->ctx;
+
+	memset(pend, 0, sizeof(*pend));
+
+	if(callback != NULL)
+		callback(connectID, err, ctx);
+}
+
+static void bg_open_poll(void)
+{
+	//los resultados no requieren comandos, se aplican aun en modo transparente
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+		if(bgOpenPend[i].active && bgOpenPend[i].hasResult)
+			bg_sckt_open_result(i, bgOpenPend[i].result);
+
+	//en modo transparente no se pueden enviar comandos AT, se espera a salir
+	if(bg_getter_transparentMode().statusTM == BG_TM_ACTIVE)
+		return;
+
+	uint32_t now = bg_get_tick_ms();
+
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+	{
+		bg_openPend_t *pend = &bgOpenPend[i];
+
+		if(!pend->active || pend->closing || !BG_DEADLINE_REACHED(now, pend->deadline))
+			continue;
+
+		//el modulo puede seguir conectando, el connectID no se libera hasta que AT+QICLOSE termine
+		if(bg_send_async(30000, bg_open_close_callback, (void*)(uintptr_t)i, "AT+QICLOSE=%d", i) != BG_OK)
+			return;
+
+		LOG_BG(LE, "[BG_ERR] SIN +QIOPEN DEL connectID: %d\n", i);
+		pend->closing = 1;
+	}
+}
+
+static void bg_open_close_callback(bg_cmdResult_t result, void *ctx)
+{
+	uint8_t connectID = (uint8_t)(uintptr_t)ctx;
+
+	if(!bgOpenPend[connectID].active || !bgOpenPend[connectID].closing)
+		return;
+
+	if(result.err != BG_OK)
+		LOG_BG(LE, "[BG_ERR] AT+QICLOSE connectID: %d err: %d\n", connectID, result.err);
+
+	bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+
+	bg_open_done(connectID, BG_ERR_OPEN_SCKT);
+}
+
+static void bg_open_wait_callback(uint8_t connectID, bg_err_t err, void *ctx)
+{
+	*(bg_err_t *)ctx = err;
+}
+
+static const uint8_t *bg_qiopen_cmd(const bgSckt_t *sckt)
+{
+	static uint8_t cmd[BG_CMD_MAX_LEN];
+
+	if(sckt->serviceType > BG_OPEN_UDP_SERVICE) return NULL;
+
+	const char *strService = bgScktServiceStr[bgOpenService[sckt->serviceType]];
+	uint8_t remote = BG_OPEN_HAS_REMOTE(sckt->serviceType);
+
+	//cliente: IP y puerto remoto con puerto local automatico, servidor/servicio: solo puerto local
+	int len = snprintf(cmd, sizeof(cmd), "AT+QIOPEN=%d,%d,\"%s\",\"%s\",%ld,%ld,%d", sckt->ctxtID, sckt->connectID,\
+		strService, remote ? (const char *)sckt->ip : BG_OPEN_SERVER_IP, remote ? sckt->remotePort : BG_OPEN_SERVER_REMOTE_PORT,\
+		remote ? BG_OPEN_CLIENT_LOCAL_PORT : sckt->localPort, sckt->accssMode);
+
+	if(len < 0 || len >= (int)sizeof(cmd)) return NULL;
+
+	return cmd;
+}
+
+bg_err_t bg_alloc_connect_id(uint8_t *connectID)
+{
+	if(connectID == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	uint16_t busy = bgConnectIDMap;
+
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+		if(bgScktTbl[i].state != BG_SCKT_STATE_INITIAL || bgOpenPend[i].active)
+			busy |= 1U << i;
+
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+	{
+		if(busy & (1U << i)) continue;
+
+		bgConnectIDMap |= 1U << i;
+		*connectID = i;
+
+		return BG_OK;
+	}
+
+	return BG_ERR_CONNECT_ID_UNSUPORTED;
+}
+
+void bg_free_connect_id(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return;
+
+	bgConnectIDMap &= ~(1U << connectID);
+}
+
+bg_err_t bg_pool_acquire(const bgSckt_t *sckt, uint8_t *connectID)
+{
+	if(sckt == NULL || connectID == NULL || sckt->ip == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	if(sckt->serviceType != BG_OPEN_CLIENT) return BG_ERR_OPEN_SCKT;
+
+	//se reutiliza un socket sin uso, conectado y con el mismo destino
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+	{
+		const bg_scktInfo_t *info = &bgScktTbl[i];
+
+		if(!bgPool[i].pooled || bgPool[i].inUse || bgPool[i].closing || bgPool[i].closeFailed ||\
+			info->state != BG_SCKT_STATE_CONNECTED)
+			continue;
+
+		if(info->ctxtID != sckt->ctxtID || info->remotePort != sckt->remotePort || info->accssMode != sckt->accssMode ||\
+			strcmp(info->ip, sckt->ip))
+			continue;
+
+		bgPool[i].inUse = 1;
+		bgPoolStats.hits++;
+		*connectID = i;
+
+		LOG_BG(LD, "[BG_LOG] POOL REUTILIZA connectID: %d (%s:%lu)\n", i, sckt->ip, sckt->remotePort);
+		return BG_OK_CONNECT_ID_OPENNED;
+	}
+
+	bgSckt_t open = *sckt;
+
+	while(bg_alloc_connect_id(&open.connectID) != BG_OK)
+		if(!bg_pool_evict()) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	bg_err_t err = bg_open_sckt(open);
+
+	if(err != BG_OK_CONNECT_ID_OPENNED)
+	{
+		bg_free_connect_id(open.connectID);
+		return err;
+	}
+
+	bgPool[open.connectID] = (bg_poolEntry_t){.pooled = 1, .inUse = 1};
+	bgPoolStats.misses++;
+	*connectID = open.connectID;
+
+	return BG_OK_CONNECT_ID_OPENNED;
+}
+
+bg_err_t bg_pool_release(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	if(!bgPool[connectID].pooled) return BG_ERR_CONNECT_ID_NOT_USED;
+
+	//un socket que cerro el punto remoto (o que ya no esta conectado) no vuelve al pool
+	if(bgScktTbl[connectID].state != BG_SCKT_STATE_CONNECTED)
+	{
+		bg_err_t err = bg_close_sckt(connectID);
+		return (err == BG_OK_CONNECT_ID_CLOSED) ? BG_OK : err;
+	}
+
+	bgPool[connectID].inUse = 0;
+	bgPool[connectID].lastUseMs = bg_get_tick_ms();
+
+	return BG_OK;
+}
+
+bg_poolStats_t bg_get_pool_stats(void)
+{
+	return bgPoolStats;
+}
+
+static void bg_pool_poll(void)
+{
+	//en modo transparente no se pueden enviar comandos AT, se espera a salir
+	if(bg_getter_transparentMode().statusTM == BG_TM_ACTIVE)
+		return;
+
+	uint32_t now = bg_get_tick_ms();
+
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+	{
+		if(!bgPool[i].pooled || bgPool[i].inUse || bgPool[i].closing)
+			continue;
+
+		if(bgPool[i].closeFailed && !BG_DEADLINE_REACHED(now, bgPool[i].retryMs))
+			continue;
+
+		uint8_t expired = (!bgPool[i].closeFailed && bgScktTbl[i].state == BG_SCKT_STATE_CONNECTED);
+
+		if(expired && !BG_DEADLINE_REACHED(now, bgPool[i].lastUseMs + BG_POOL_IDLE_MS))
+			continue;
+
+		//lo pendiente del envio agrupado va antes de AT+QICLOSE, con la cola llena se reintenta en otra pasada
+		if(bg_tx_coalesce_flush(i, &bgTxCoalesce[i].stats.flushPoolClose, 0) != BG_OK)
+			return;
+
+		if(bg_send_async(30000, bg_pool_close_callback, (void*)(uintptr_t)i, "AT+QICLOSE=%d", i) != BG_OK)
+			return;
+
+		bgPool[i].closing = 1;
+
+		if(expired)
+		{
+			LOG_BG(LE, "[BG_LOG] POOL CIERRA connectID: %d SIN USO\n", i);
+			bgPoolStats.expired++;
+		}
+	}
+}
+
+static void bg_pool_close_callback(bg_cmdResult_t result, void *ctx)
+{
+	uint8_t connectID = (uint8_t)(uintptr_t)ctx;
+
+	//si AT+QICLOSE falla el socket sigue en el pool (bgScktTbl no cambia) y se reintenta mas tarde
+	if(result.err != BG_OK)
+	{
+		LOG_BG(LE, "[BG_ERR] POOL AT+QICLOSE connectID: %d err: %d\n", connectID, result.err);
+		bgPool[connectID].closing = 0;
+		bgPool[connectID].closeFailed = 1;
+		bgPool[connectID].retryMs = bg_get_tick_ms() + BG_POOL_CLOSE_RETRY_MS;
+		return;
+	}
+
+	bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+
+	bgConnectIDMap &= ~(1U << connectID);
+	memset(&bgPool[connectID], 0, sizeof(bgPool[connectID]));
+}
+
+static uint8_t bg_pool_evict(void)
+{
+	uint8_t oldest = BG_SCKT_NONE;
+
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+		if(bgPool[i].pooled && !bgPool[i].inUse && !bgPool[i].closing &&\
+			(oldest == BG_SCKT_NONE || (int32_t)(bgPool[i].lastUseMs - bgPool[oldest].lastUseMs) < 0))
+			oldest = i;
+
+	if(oldest == BG_SCKT_NONE || bg_close_sckt(oldest) != BG_OK_CONNECT_ID_CLOSED)
+		return 0;
+
+	bgPoolStats.evicted++;
+
+	return 1;
+}
+
+bg_infoTM_t *bg_getter_instance_TM(void)
+{
+	static bg_infoTM_t infoTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_RESET,
+		 .connectID = 200}; 
+	return &infoTM;
+
+	//NOTA: el valor de 200 se escoge para no inicializar en alguna conexion soportada (0-11) 
+}
+
+void bg_setter_transparentMode(bg_infoTM_t value)
+{
+	bg_infoTM_t *infoTM = bg_getter_instance_TM();
+
+	//la salida de TM es el evento que programa el regreso, despues de NO CARRIER solo se notifica una vez
+	if(infoTM->statusTM == BG_TM_ACTIVE && value.statusTM == BG_TM_INACTIVE)
+		bg_tm_reentry_schedule((value.statusNoCarrier == BG_TM_NO_CARRIER_SET) ? 1 : bgTmReentry.maxTries);
+
+	else if(value.statusTM == BG_TM_ACTIVE)
+	{
+		bgTmReentryTries = 0;
+		bgTmDataMode = 1;
+	}
+
+	*infoTM = value;
+}
+
+static void bg_tm_reentry_schedule(uint8_t tries)
+{
+	bgTmReentryTries = (tries < bgTmReentry.maxTries) ? tries : bgTmReentry.maxTries;
+	bgTmReentryDelay = bgTmReentry.delayMs;
+	bgTmReentryAt = bg_get_tick_ms() + bgTmReentryDelay;
+}
+
+void bg_set_tm_reentry(bg_tmReentry_t policy)
+{
+	bgTmReentry = policy;
+
+	if(bgTmReentryTries > policy.maxTries)
+		bgTmReentryTries = policy.maxTries;
+}
+
+bg_infoTM_t bg_getter_transparentMode(void)
+{
+	bg_infoTM_t *infoTM = bg_getter_instance_TM();
+	return *infoTM;
+}
+
+bg_err_t bg_set_tm_wait_time(uint8_t waitTime)
+{
+	if(waitTime > BG_TM_WAIT_TIME_MAX) return BG_ERR_TM_WAIT_TIME;
+
+	bgTmWaitTime = waitTime;
+
+	return BG_OK;
+}
+
+bg_err_t bg_transparent_mode(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	bg_infoTM_t infoTM = bg_getter_transparentMode();
+
+	if(infoTM.statusTM == BG_TM_ACTIVE) return BG_OK_TRANSPARENT_MODE;
+
+	bg_err_t err;
+
+	if(bgTmWaitTimeModule != bgTmWaitTime)
+	{
+		err = bg_send(10000, LE, "AT+QICFG=\"transwaittm\",%d", bgTmWaitTime); 
+		CHECK_BG_ERR(err);
+
+		bgTmWaitTimeModule = bgTmWaitTime;
+	}
+
+	//el tokenizador cambia a modo transparente en cuanto llega "CONNECT"
+	bgTmPendingID = connectID;
+	err = bg_send(10000, LE, "AT+QISWTMD=%d,2", connectID); 
+	if(err != BG_OK) bgTmPendingID = BG_TM_NO_PENDING;
+	CHECK_BG_ERR(err);
+
+	CHECK_DESIRED_ANSW(BG_TOKEN_MASK(BG_TOK_CONNECT), BG_TIMEOUT_ANSW_OK);
+	bgTmPendingID = BG_TM_NO_PENDING;
+	bgTmLastTx = bg_get_tick_ms();
+
+	bg_infoTM_t valueTM = {.statusTM = BG_TM_ACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_RESET,\
+		 .connectID = connectID};
+
+	bg_setter_transparentMode(valueTM);
+
+	return BG_OK_TRANSPARENT_MODE;
+}
+//-----------------------Funciones de apertura de socket end------------------------
+
+
+//-----------------------------------Tabla de sockets--------------------------------
+bg_scktState_t bg_get_sckt_state(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_SCKT_STATE_INITIAL;
+
+	return bgScktTbl[connectID].state;
+}
+
+const bg_scktInfo_t *bg_get_sckt_info(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return NULL;
+
+	return &bgScktTbl[connectID];
+}
+
+static void bg_sckt_opening(const bgSckt_t *sckt)
+{
+	if(sckt->connectID > BG_CONNECT_ID_MAX) return;
+
+	bg_scktInfo_t *info = &bgScktTbl[sckt->connectID];
+
+	memset(info, 0, sizeof(*info));
+	info->service = (sckt->serviceType <= BG_OPEN_UDP_SERVICE) ? bgOpenService[sckt->serviceType] : BG_SCKT_SERVICE_UNKNOWN;
+	info->ctxtID = sckt->ctxtID;
+	info->accssMode = sckt->accssMode;
+	info->localPort = BG_OPEN_HAS_REMOTE(sckt->serviceType) ? BG_OPEN_CLIENT_LOCAL_PORT : sckt->localPort;
+
+	if(BG_OPEN_HAS_REMOTE(sckt->serviceType) && sckt->ip != NULL)
+	{
+		strncpy(info->ip, sckt->ip, BG_SCKT_IP_LEN - 1);
+		info->remotePort = sckt->remotePort;
+	}
+
+	bg_sckt_set_state(sckt->connectID, BG_SCKT_STATE_OPENING);
+}
+
+static void bg_sckt_set_state(uint8_t connectID, bg_scktState_t state)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return;
+
+	bg_scktInfo_t *info = &bgScktTbl[connectID];
+
+	if(state == BG_SCKT_STATE_INITIAL)
+		memset(info, 0, sizeof(*info));
+
+	info->state = state;
+	info->updatedMs = bg_get_tick_ms();
+}
+
+static void bg_sckt_open_result(uint8_t connectID, uint16_t result)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return;
+
+	//un +QIOPEN repetido (ej. respuesta directa y URC) no cambia un socket que ya se abrio o se cerro
+	if(bgScktTbl[connectID].state != BG_SCKT_STATE_OPENING)
+		return;
+
+	//un +QIOPEN tardio de una apertura que ya vencio se ignora, el AT+QICLOSE en curso cierra el socket
+	if(bgOpenPend[connectID].closing)
+		return;
+
+	if(result != 0)
+		bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+
+	else if(bgScktTbl[connectID].service == BG_SCKT_SERVICE_TCP_LISTENER ||\
+		bgScktTbl[connectID].service == BG_SCKT_SERVICE_UDP_SERVICE)
+		bg_sckt_set_state(connectID, BG_SCKT_STATE_LISTENING);
 
-		bg_infoTM_t infoTM = bg_getter_transparentMode();
+	else
+		bg_sckt_set_state(connectID, BG_SCKT_STATE_CONNECTED);
+
+	bg_open_done(connectID, (result == 0) ? BG_OK_CONNECT_ID_OPENNED : BG_ERR_OPEN_SCKT);
+}
+
+static void bg_sckt_urc(const urcInfoData_t *infoUrc)
+{
+	switch(infoUrc->type)
+	{
+		case BG_URC_QIOPEN:
+			bg_sckt_open_result(infoUrc->connectID, infoUrc->result);
+		break;
 
-		if(infoTM.statusTM == BG_TM_INACTIVE)
+		case BG_URC_CLOSED:
+			if(infoUrc->connectID <= BG_CONNECT_ID_MAX && bgScktTbl[infoUrc->connectID].state != BG_SCKT_STATE_INITIAL)
+				bg_sckt_set_state(infoUrc->connectID, BG_SCKT_STATE_CLOSING);
+
+			//un socket del pool en CLOSING ya no se reutiliza, bg_pool_poll() lo cierra si nadie lo usa
+			if(infoUrc->connectID <= BG_CONNECT_ID_MAX && bgPool[infoUrc->connectID].pooled)
+				bgPoolStats.peerClosed++;
+		break;
+
+		case BG_URC_INCOMING:
 		{
-			bg_infoTM_t infoTM = bg_getter_transparentMode();
-			bg_callback_TM_Inactive(infoTM.connectID, infoTM.statusNoCarrier);
+			//la conexion aceptada hereda el contexto y el puerto local del servidor
+			if(infoUrc->connectID > BG_CONNECT_ID_MAX) break;
+
+			bg_scktInfo_t *info = &bgScktTbl[infoUrc->connectID];
+			const bg_scktInfo_t *server = (infoUrc->serverID <= BG_CONNECT_ID_MAX) ? &bgScktTbl[infoUrc->serverID] : NULL;
+
+			memset(info, 0, sizeof(*info));
+			info->service = BG_SCKT_SERVICE_TCP_INCOMING;
+			info->serverID = infoUrc->serverID;
+
+			if(server != NULL)
+			{
+				info->ctxtID = server->ctxtID;
+				info->accssMode = server->accssMode;
+				info->localPort = server->localPort;
+			}
+
+			bg_sckt_set_state(infoUrc->connectID, BG_SCKT_STATE_CONNECTED);
 		}
+		break;
+
+		case BG_URC_PDP_DEACT:
+			if(infoUrc->contextID >= BG_CONTEXT_ID_MIN && infoUrc->contextID <= BG_CONTEXT_ID_MAX)
+			{
+				memset(&bgPdpTbl[infoUrc->contextID - BG_CONTEXT_ID_MIN], 0, sizeof(bg_pdpInfo_t));
+				bgPdpTbl[infoUrc->contextID - BG_CONTEXT_ID_MIN].updatedMs = bg_get_tick_ms();
+			}
+
+			//los sockets del contexto quedan sin red, se deben cerrar con AT+QICLOSE
+			for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+				if(bgScktTbl[i].state != BG_SCKT_STATE_INITIAL && bgScktTbl[i].ctxtID == infoUrc->contextID)
+					bg_sckt_set_state(i, BG_SCKT_STATE_CLOSING);
+		break;
+	}
+}
+
+static uint8_t bg_sckt_parse_qistate(uint8_t *line)
+{
+	//+QISTATE: <connectID>,"<service_type>","<IP_address>",<remote_port>,<local_port>,<socket_state>,<contextID>,
+	//<serverID>,<access_mode>,"<AT_port>"
+	uint8_t *field[9] = {NULL};
+	uint8_t *parsePtr = strchr(line, ' ');
+
+	for(uint8_t i = 0; i < sizeof(field) / sizeof(field[0]) && parsePtr != NULL; i++)
+	{
+		field[i] = parsePtr + 1;
+		parsePtr = strchr(field[i], ',');
+	}
+
+	if(field[8] == NULL) return BG_SCKT_NONE;
+
+	uint8_t connectID = atoi(field[0]);
+
+	if(connectID > BG_CONNECT_ID_MAX) return BG_SCKT_NONE;
+
+	uint8_t service[20] = {'\0'}, ip[BG_SCKT_IP_LEN] = {'\0'};
+	COPY_PARSE_STR(service, sizeof(service), field[1], '"', '"');
+	COPY_PARSE_STR(ip, sizeof(ip), field[2], '"', '"');
+
+	bg_scktInfo_t *info = &bgScktTbl[connectID];
+
+	//un socket que la tabla no conocia (ej. despues de un reset del MCU) empieza sus contadores en 0
+	if(info->state == BG_SCKT_STATE_INITIAL)
+		memset(info, 0, sizeof(*info));
+
+	info->service = BG_SCKT_SERVICE_UNKNOWN;
+
+	for(uint8_t i = 0; i < BG_SCKT_SERVICE_UNKNOWN; i++)
+		if(!strcmp(service, bgScktServiceStr[i]))
+			info->service = i;
+
+	memcpy(info->ip, ip, sizeof(ip));
+	info->remotePort = atoi(field[3]);
+	info->localPort = atoi(field[4]);
+	info->ctxtID = atoi(field[6]);
+	info->serverID = atoi(field[7]);
+	info->accssMode = atoi(field[8]);
+
+	uint8_t state = atoi(field[5]);
+	bg_sckt_set_state(connectID, (state <= BG_SCKT_STATE_CLOSING) ? state : BG_SCKT_STATE_CLOSING);
+
+	return connectID;
+}
+
+bg_err_t bg_refresh_sckt_table(uint8_t ctxtID)
+{
+	if(ctxtID != 0 && (ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN)) return BG_ERR_CTXT_ID_UNSUPPORTED;
+
+	uint8_t qistateCmd[20] = "AT+QISTATE";
+	uint8_t *qistateResp = bgRefreshResp, *qiactResp = &bgRefreshResp[BG_QISTATE_RESP_LEN];
+
+	memset(bgRefreshResp, 0, sizeof(bgRefreshResp));
+
+	if(ctxtID != 0)
+		sprintf(qistateCmd, "AT+QISTATE=0,%d", ctxtID);
+
+	//una sola linea "AT+QISTATE;+QIACT?", bg_send_batch() reparte las lineas de cada comando
+	bg_batchCmd_t batch[] = {
+		{.cmd = qistateCmd, .timeout = BG_TIMEOUT_ANSW, .concat = 1, .resp = qistateResp, .respSize = BG_QISTATE_RESP_LEN},
+		{.cmd = "AT+QIACT?", .timeout = BG_TIMEOUT_ANSW, .concat = 1, .resp = qiactResp, .respSize = BG_QIACT_RESP_LEN}
+	};
+
+	bg_err_t err = bg_send_batch(batch, sizeof(batch) / sizeof(batch[0]));
+
+	if(batch[1].err == BG_OK)
+		bg_pdp_parse_qiact(qiactResp);
+
+	if(batch[0].err != BG_OK)
+		return batch[0].err;
+
+	uint16_t listed = 0;
+	uint8_t *parsePtr = qistateResp;
+
+	while((parsePtr = strstr(parsePtr, "+QISTATE: ")) != NULL)
+	{
+		uint8_t connectID = bg_sckt_parse_qistate(parsePtr);
+
+		if(connectID != BG_SCKT_NONE)
+			listed |= 1U << connectID;
+
+		parsePtr++;
+	}
+
+	//los sockets que ya no estan en la lista se cerraron sin URC (ej. reinicio del modulo), los que esperan
+	//+QIOPEN se resuelven con su URC
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
+	{
+		bg_scktInfo_t *info = &bgScktTbl[i];
+
+		if((listed & (1U << i)) || info->state == BG_SCKT_STATE_INITIAL || info->state == BG_SCKT_STATE_OPENING ||\
+			(ctxtID != 0 && info->ctxtID != ctxtID))
+			continue;
+
+		bg_sckt_set_state(i, BG_SCKT_STATE_INITIAL);
+	}
+
+	LOG_BG(LD, "[BG_LOG] TABLA DE SOCKETS ACTUALIZADA, CONNECTID EN USO: 0x%03X\n", listed);
+
+	return (err == BG_OK || BG_IS_AT_ERR(err)) ? BG_OK : err;
+}
+
+const bg_pdpInfo_t *bg_get_pdp_info(uint8_t ctxtID)
+{
+	if(ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN) return NULL;
+
+	return &bgPdpTbl[ctxtID - BG_CONTEXT_ID_MIN];
+}
+
+static void bg_pdp_parse_qiact(uint8_t *resp)
+{
+	uint32_t now = bg_get_tick_ms();
+
+	//AT+QIACT? solo lista los contextos activados
+	memset(bgPdpTbl, 0, sizeof(bgPdpTbl));
+
+	for(uint8_t i = 0; i <= BG_CONTEXT_ID_MAX - BG_CONTEXT_ID_MIN; i++)
+		bgPdpTbl[i].updatedMs = now;
+
+	uint8_t *parsePtr = resp;
+
+	while((parsePtr = strstr(parsePtr, "+QIACT: ")) != NULL)
+	{
+		//+QIACT: <contextID>,<context_state>,<context_type>[,"<IP_address>"]
+		parsePtr += strlen("+QIACT: ");
+		uint8_t ctxtID = atoi(parsePtr);
+		uint8_t *statePtr = strchr(parsePtr, ',');
+		uint8_t *typePtr = (statePtr != NULL) ? strchr(statePtr + 1, ',') : NULL;
+
+		if(typePtr == NULL || ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN) continue;
+
+		bg_pdpInfo_t *pdp = &bgPdpTbl[ctxtID - BG_CONTEXT_ID_MIN];
+		uint8_t *ipPtr = strchr(typePtr + 1, '"'), *eol = strchr(typePtr + 1, '\n');
+
+		pdp->active = (atoi(statePtr + 1) == 1);
+		pdp->ctxtType = atoi(typePtr + 1);
+
+		//la IP es opcional, solo se copia si esta en la misma linea
+		if(ipPtr != NULL && (eol == NULL || ipPtr < eol))
+			COPY_PARSE_STR(pdp->ip, sizeof(pdp->ip), typePtr + 1, '"', '"');
+	}
+}
+//-----------------------------------Tabla de sockets end----------------------------
+
+
+//-----------------------------------Arranque de red---------------------------------
+bg_err_t bg_bringup_start(const bg_bringupCfg_t *cfg)
+{
+	if(cfg == NULL || (cfg->nSckt > 0 && cfg->sckt == NULL)) return BG_ERR_MCU_PTR_NULL;
+
+	if(cfg->pdp.ctxtID > BG_CONTEXT_ID_MAX || cfg->pdp.ctxtID < BG_CONTEXT_ID_MIN) return BG_ERR_CTXT_ID_UNSUPPORTED;
+
+	if(cfg->nSckt > BG_CONNECT_ID_MAX + 1) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	for(uint8_t i = 0; i < cfg->nSckt; i++)
+		if(cfg->sckt[i].connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	//los callbacks de un arranque anterior no deben alterar al nuevo
+	while(bgBringup.pending > 0)
+	{
+		bg_poll();
+		bg_wait_event(bg_get_tick_ms() + BG_WAIT_EVENT_MAX_MS);
+	}
+
+	memset(&bgBringup, 0, sizeof(bgBringup));
+	bgBringup.cfg = cfg;
+	bgBringup.t0 = bg_get_tick_ms();
+	bgBringup.stats.stage = BG_BRINGUP_POWER;
+	bgBringup.stats.failStage = BG_BRINGUP_IDLE;
+	bgBringup.stats.err = BG_OK;
+	bgBringup.pwrState = BG_BRINGUP_PWR_PROBE;
+	bgBringup.pwrTries = BG_BOOT_PROBE_TRIES;
+
+	//DTR en ON, con AT&D1 el flanco ON->OFF saca al modulo de modo transparente
+	if(bgDtrPin)
+		bgGpioWrite(BG_DTR_PIN, 1);
+
+	bg_bringup_begin(BG_BRINGUP_POWER);
+
+	return BG_OK;
+}
+
+bg_bringupStage_t bg_bringup_step(void)
+{
+	const bg_bringupCfg_t *cfg = bgBringup.cfg;
+
+	bg_handle_urc();
+
+	if(cfg == NULL || bgBringup.stats.stage >= BG_BRINGUP_DONE)
+		return bgBringup.stats.stage;
+
+	if(!(bgBringup.doneMask & BG_BRINGUP_BIT(BG_BRINGUP_POWER)))
+	{
+		bg_bringup_power();
+
+		//las demas etapas empiezan al terminar el encendido
+		if(!(bgBringup.doneMask & BG_BRINGUP_BIT(BG_BRINGUP_POWER)))
+			return bgBringup.stats.stage;
+	}
+
+	uint8_t done = bgBringup.doneMask;
+
+	if(!(bgBringup.sentMask & BG_BRINGUP_BIT(BG_BRINGUP_REQ_QICSGP)))
+		bg_bringup_submit(BG_BRINGUP_REQ_QICSGP, BG_TIMEOUT_ANSW_OK_LONG, "AT+QICSGP=%d,%d,\"%s\",\"%s\",\"%s\",%d",\
+			cfg->pdp.ctxtID, cfg->pdp.contextType, cfg->pdp.apn, cfg->pdp.usr, cfg->pdp.psw, cfg->pdp.auth);
+
+	if(!(done & BG_BRINGUP_BIT(BG_BRINGUP_SIM)))
+		bg_bringup_poll(BG_BRINGUP_REQ_CPIN, "AT+CPIN?");
+
+	else if(!(done & BG_BRINGUP_BIT(BG_BRINGUP_ATTACH)))
+	{
+		//AT+COPS ocupa el canal AT hasta que el modulo se registra, mientras tanto no se consulta AT+CEREG?
+		if(cfg->operator != NULL && !(bgBringup.sentMask & BG_BRINGUP_BIT(BG_BRINGUP_REQ_COPS)))
+			bg_bringup_submit(BG_BRINGUP_REQ_COPS, BG_BRINGUP_ATTACH_TIMEOUT, "AT+COPS=4,2,\"%s\",8", cfg->operator);
+
+		else if(!(bgBringup.reqMask & BG_BRINGUP_BIT(BG_BRINGUP_REQ_COPS)))
+			bg_bringup_poll(BG_BRINGUP_REQ_CEREG, "AT+CEREG?");
+	}
+
+	if((done & BG_BRINGUP_BIT(BG_BRINGUP_SIM)) && (done & BG_BRINGUP_BIT(BG_BRINGUP_ATTACH)) &&\
+		(done & BG_BRINGUP_BIT(BG_BRINGUP_PDP_CONF)) && !(done & BG_BRINGUP_BIT(BG_BRINGUP_PDP_ACT)))
+	{
+		if(!(bgBringup.beganMask & BG_BRINGUP_BIT(BG_BRINGUP_PDP_ACT)))
+			bg_bringup_begin(BG_BRINGUP_PDP_ACT);
+
+		if(!(bgBringup.sentMask & BG_BRINGUP_BIT(BG_BRINGUP_REQ_QIACT)))
+			bg_bringup_submit(BG_BRINGUP_REQ_QIACT, BG_BRINGUP_PDP_TIMEOUT, "AT+QIACT=%d", cfg->pdp.ctxtID);
+
+		else if(bgBringup.pdpQuery && bg_bringup_submit(BG_BRINGUP_REQ_QIACT_QUERY, BG_TIMEOUT_ANSW, "AT+QIACT?") == BG_OK)
+			bgBringup.pdpQuery = 0;
+	}
+
+	if(done & BG_BRINGUP_BIT(BG_BRINGUP_PDP_ACT))
+	{
+		if(!(bgBringup.beganMask & BG_BRINGUP_BIT(BG_BRINGUP_SOCKETS)))
+			bg_bringup_begin(BG_BRINGUP_SOCKETS);
+
+		//los AT+QIOPEN se encolan juntos, cada socket termina con su URC +QIOPEN
+		for(uint8_t i = 0; i < cfg->nSckt; i++)
+			if(!(bgBringup.scktSent & (1U << i)) && bg_bringup_open(i) != BG_OK)
+				break;
+
+		if(bgBringup.scktOpen == (uint16_t)((1UL << cfg->nSckt) - 1))
+			bg_bringup_finish(BG_BRINGUP_SOCKETS);
+	}
+
+	for(bg_bringupStage_t stage = BG_BRINGUP_POWER; stage < BG_BRINGUP_DONE; stage++)
+	{
+		uint8_t bit = BG_BRINGUP_BIT(stage);
+
+		if((bgBringup.beganMask & bit) && !(bgBringup.doneMask & bit) && bgBringupTimeout[stage] != 0 &&\
+			BG_DEADLINE_REACHED(bg_get_tick_ms(), bgBringup.deadline[stage]))
+			bg_bringup_fail(stage, bgBringupErr[stage]);
+	}
+
+	if(bgBringup.stats.stage >= BG_BRINGUP_DONE)
+		return bgBringup.stats.stage;
+
+	bg_bringupStage_t stage = BG_BRINGUP_POWER;
+
+	while(stage < BG_BRINGUP_DONE && (bgBringup.doneMask & BG_BRINGUP_BIT(stage)))
+		stage++;
+
+	bgBringup.stats.stage = stage;
+
+	if(stage == BG_BRINGUP_DONE)
+	{
+		bgBringup.stats.readyMs = bg_get_tick_ms() - bgBringup.t0;
+		LOG_BG(LE, "[BG_LOG] ARRANQUE DE RED TERMINADO EN %lu ms\n", bgBringup.stats.readyMs);
+	}
+
+	return stage;
+}
+
+bg_bringupStats_t bg_get_bringup_stats(void)
+{
+	return bgBringup.stats;
+}
+
+static void bg_bringup_begin(bg_bringupStage_t stage)
+{
+	uint32_t now = bg_get_tick_ms();
+
+	bgBringup.beganMask |= BG_BRINGUP_BIT(stage);
+	bgBringup.stats.startMs[stage] = now - bgBringup.t0;
+	bgBringup.deadline[stage] = now + bgBringupTimeout[stage];
+}
+
+static void bg_bringup_finish(bg_bringupStage_t stage)
+{
+	uint8_t bit = BG_BRINGUP_BIT(stage);
 
+	//un URC de una etapa que aun no inicia (o que ya termino) no cuenta
+	if(!(bgBringup.beganMask & bit) || (bgBringup.doneMask & bit))
 		return;
+
+	bgBringup.doneMask |= bit;
+	bgBringup.stats.durationMs[stage] = bg_get_tick_ms() - bgBringup.t0 - bgBringup.stats.startMs[stage];
+
+	bg_bringup_callback(stage, BG_OK, bgBringup.stats.durationMs[stage]);
+
+	//SIM, configuracion PDP y registro avanzan en paralelo
+	if(stage == BG_BRINGUP_POWER)
+	{
+		bg_bringup_begin(BG_BRINGUP_SIM);
+		bg_bringup_begin(BG_BRINGUP_PDP_CONF);
+		bg_bringup_begin(BG_BRINGUP_ATTACH);
 	}
+}
 
-	bg_infoTM_t infoTM = bg_getter_transparentMode();
-	if(infoTM.statusTM == BG_TM_ACTIVE)
-		if(bg_exit_transparent_mode() == BG_OK_EXIT_TRANSPARENT_MODE)
-			LOG_BG(LE, "*Salida de TM Exitosa*\n");
+static void bg_bringup_fail(bg_bringupStage_t stage, bg_err_t err)
+{
+	if(bgBringup.stats.stage >= BG_BRINGUP_DONE)
+		return;
 
-	urcRawData_t urcPop;
-	bg_queue_pop(&urcPop);
+	bgBringup.stats.stage = BG_BRINGUP_FAIL;
+	bgBringup.stats.failStage = stage;
+	bgBringup.stats.err = err;
 
-	LOG_BG(LE,"\nlen:%ld\ntype:%d\nbuff: %s", urcPop.len, urcPop.type, urcPop.buff);
-	urcInfoData_t infoUrc;
-	switch(urcPop.type)
+	LOG_BG(LE, "[BG_ERR] FALLO ARRANQUE DE RED, ETAPA: %d ERROR: %d\n", stage, err);
+	bg_bringup_callback(stage, err, bg_get_tick_ms() - bgBringup.t0 - bgBringup.stats.startMs[stage]);
+}
+
+static bg_err_t bg_bringup_submit(uint8_t req, uint32_t timeout, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	bg_err_t err = bg_cmd_submit(timeout, LE, NULL, 0, bg_bringup_cmd_callback, (void *)(uintptr_t)req, fmt, args);
+	va_end(args);
+
+	if(err != BG_OK)
+		return err;
+
+	bgBringup.pending++;
+
+	if(req < BG_BRINGUP_REQ_QIOPEN)
 	{
-		case BG_URC_EXIT_TM:
-			if(bg_exit_transparent_mode() == BG_OK_EXIT_TRANSPARENT_MODE)
+		bgBringup.reqMask |= BG_BRINGUP_BIT(req);
+		bgBringup.sentMask |= BG_BRINGUP_BIT(req);
+	}
+
+	return BG_OK;
+}
+
+static void bg_bringup_power(void)
+{
+	//cada subetapa espera el resultado de su comando en bg_bringup_cmd_callback()
+	if(bgBringup.pending > 0 || bgBringup.stats.stage >= BG_BRINGUP_DONE)
+		return;
+
+	uint32_t now = bg_get_tick_ms();
+
+	switch(bgBringup.pwrState)
+	{
+		case BG_BRINGUP_PWR_PROBE:
+			if(bgModuleInit)
 			{
-				LOG_BG(LE, "Salida de TM Exitosa\n");
+				bgBringup.pwrState = BG_BRINGUP_PWR_SETUP;
+				bg_bringup_finish(BG_BRINGUP_POWER);
+				break;
 			}
+
+			bg_bringup_submit(BG_BRINGUP_REQ_AT, BG_TIMEOUT_QUICK, "AT");
+		break;
+
+		case BG_BRINGUP_PWR_READY:
+			bg_bringup_submit(BG_BRINGUP_REQ_AT, BG_TIMEOUT_QUICK, "AT");
+		break;
+
+		case BG_BRINGUP_PWR_PULSE:
+			if(!BG_DEADLINE_REACHED(now, bgBringup.pwrDeadline))
+				break;
+
+			bgGpioWrite(bgBringup.pwrPin, 0);
+			bgBringup.pwrState = BG_BRINGUP_PWR_BOOT;
+			bgBringup.pwrDeadline = now + BG_BOOT_TIMEOUT;
+		break;
+
+		case BG_BRINGUP_PWR_BOOT:
+			//Despues de RDY el modulo contesta de inmediato, con STATUS puede tardar un poco mas en aceptar comandos
+			if(bgRxTokens & BG_TOKEN_MASK(BG_TOK_RDY))
+				bgBringup.pwrTries = BG_BOOT_PROBE_TRIES;
+
+			else if(bgStatusRead != NULL && bgStatusRead())
+				bgBringup.pwrTries = BG_BOOT_TIMEOUT / BG_TIMEOUT_QUICK;
+
 			else
-			{	
-				bg_infoTM_t infoTM = bg_getter_transparentMode();
+			{
+				if(BG_DEADLINE_REACHED(now, bgBringup.pwrDeadline))
+				{
+					LOG_BG(LE,"[BG_ERR] TIMEOUT ARRANQUE DEL MODULO (RDY/STATUS)\n");
+					bgBringup.pwrState = BG_BRINGUP_PWR_PROBE;
+					bgBringup.pwrTries = BG_BOOT_PROBE_TRIES;
+				}
+				break;
+			}
+
+			bgBringup.pwrState = BG_BRINGUP_PWR_READY;
+		break;
+
+		case BG_BRINGUP_PWR_CONFIG:
+		{
+			bg_err_t err = bg_config_module();
+
+			if(err != BG_OK)
+			{
+				bg_bringup_fail(BG_BRINGUP_POWER, err);
+				break;
+			}
+
+			bgBringup.pwrState = BG_BRINGUP_PWR_SETUP;
+		}
+		break;
+
+		case BG_BRINGUP_PWR_SETUP:
+			if(bgDtrPin && !(bgBringup.sentMask & BG_BRINGUP_BIT(BG_BRINGUP_REQ_ATD1)) &&\
+				bg_bringup_submit(BG_BRINGUP_REQ_ATD1, BG_TIMEOUT_QUICK, "AT&D1") != BG_OK)
+				break;
+
+			if(!(bgBringup.sentMask & BG_BRINGUP_BIT(BG_BRINGUP_REQ_QRFTESTMODE)))
+				bg_bringup_submit(BG_BRINGUP_REQ_QRFTESTMODE, 10000, "AT+QRFTESTMODE=0");
+		break;
+	}
+}
+
+static void bg_bringup_pulse(void)
+{
+	if(bgBringup.pwrAttempts >= BG_POWER_ON_ATTEMPTS)
+	{
+		bg_bringup_fail(BG_BRINGUP_POWER, BG_ERR_TIMEOUT_ANS_DESIRED);
+		return;
+	}
+
+	printf("POWER ON... ATTEMP: %d\n", ++bgBringup.pwrAttempts);
+
+	bg_resp_reset();
+	bg_module_state_reset();
+
+	//Con STATUS activo el modulo esta encendido pero no contesta (ej. en modo transparente), un pulso de
+	//PWRKEY lo apagaria, por eso se reinicia con RESET_N
+	uint8_t reset = (bgStatusRead != NULL && bgStatusRead());
+
+	bgBringup.pwrPin = reset ? BG_RESET_PIN : BG_PWRKEY_PIN;
+	bgBringup.pwrDeadline = bg_get_tick_ms() + (reset ? BG_RESET_PULSE_MS : BG_PWRKEY_PULSE_MS);
+	bgBringup.pwrState = BG_BRINGUP_PWR_PULSE;
+
+	bgGpioWrite(bgBringup.pwrPin, 1);
+}
+
+static bg_err_t bg_bringup_open(uint8_t idx)
+{
+	const bgSckt_t *sckt = &bgBringup.cfg->sckt[idx];
+	const uint8_t *cmd = bg_qiopen_cmd(sckt);
+
+	if(cmd == NULL) return BG_ERR_OPEN_SCKT;
+
+	bg_err_t err = bg_bringup_submit(BG_BRINGUP_REQ_QIOPEN + idx, BG_OPEN_TIMEOUT, "%s", cmd);
+
+	if(err == BG_OK)
+	{
+		bgBringup.scktSent |= 1U << idx;
+		bg_sckt_opening(sckt);
+	}
+
+	return err;
+}
+
+static void bg_bringup_poll(bg_bringupReq_t req, const char *cmd)
+{
+	//la primera consulta de cada tipo se envia de inmediato
+	if((bgBringup.reqMask & BG_BRINGUP_BIT(req)) || ((bgBringup.sentMask & BG_BRINGUP_BIT(req)) &&\
+		!BG_DEADLINE_REACHED(bg_get_tick_ms(), bgBringup.nextPoll)))
+		return;
+
+	if(bg_bringup_submit(req, BG_TIMEOUT_ANSW, "%s", cmd) == BG_OK)
+		bgBringup.nextPoll = bg_get_tick_ms() + BG_BRINGUP_POLL_MS;
+}
+
+static void bg_bringup_cmd_callback(bg_cmdResult_t result, void *ctx)
+{
+	uint8_t req = (uint8_t)(uintptr_t)ctx;
+
+	bgBringup.pending--;
+
+	if(req < BG_BRINGUP_REQ_QIOPEN)
+		bgBringup.reqMask &= ~BG_BRINGUP_BIT(req);
+
+	if(bgBringup.cfg == NULL || bgBringup.stats.stage >= BG_BRINGUP_DONE)
+		return;
+
+	//el resultado de la apertura llega despues con el URC +QIOPEN, aqui solo se revisa que se acepto el comando
+	if(req >= BG_BRINGUP_REQ_QIOPEN)
+	{
+		if(result.err == BG_OK)
+			return;
+
+		//el modulo no acepto AT+QIOPEN, no llegara +QIOPEN que saque al socket de OPENING
+		uint8_t connectID = bgBringup.cfg->sckt[req - BG_BRINGUP_REQ_QIOPEN].connectID;
+
+		if(bgScktTbl[connectID].state == BG_SCKT_STATE_OPENING)
+			bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+
+		bg_bringup_fail(BG_BRINGUP_SOCKETS, BG_ERR_OPEN_SCKT);
+		return;
+	}
 
-				if(infoTM.statusNoCarrier == BG_TM_NO_CARRIER_SET)
-					LOG_BG(LE, "Salida de TM por desconexion NO CARRIER\n");
-				// else
-				// {
-				// 	LOG_BG(LE, "Salida de TM NO Exitosa\n");
-				// 	bg_infoTM_t valueTM = {.statusTM = BG_TM_ACTIVE, .statusNoCarrier = infoTM.statusNoCarrier,\
-				// 		 .connectID = infoTM.connectID};
-				// 	bg_setter_transparentMode(valueTM);
-				// }
+	switch(req)
+	{
+		case BG_BRINGUP_REQ_AT:
+			if(result.err == BG_OK)
+			{
+				if(bgBringup.pwrState == BG_BRINGUP_PWR_PROBE)
+					LOG_BG(LD,"[BG_LOG] MODULO YA ENCENDIDO\n");
+
+				bgBringup.pwrState = BG_BRINGUP_PWR_CONFIG;
 			}
-		break;
 
-		case BG_URC_CLOSED:
-			COPY_PARSE_STR(infoUrc.buff, sizeof(infoUrc.buff), urcPop.buff, ',', '\n');
-			infoUrc.connectID = atoi(infoUrc.buff);
-			infoUrc.type = urcPop.type;
-			bg_urc_parsed_callback(infoUrc);
+			//sin respuesta se reintenta en el siguiente paso, al agotar los intentos se enciende (o se reintenta)
+			else if(bgBringup.pwrTries > 0 && --bgBringup.pwrTries == 0)
+				bg_bringup_pulse();
 		break;
 
-		case BG_URC_INCOMING:
-			COPY_PARSE_STR(infoUrc.buff, sizeof(infoUrc.buff), urcPop.buff, ',', ',');
-			infoUrc.connectID = atoi(infoUrc.buff);
+		case BG_BRINGUP_REQ_ATD1:
+			if(result.err != BG_OK)
+				bg_bringup_fail(BG_BRINGUP_POWER, result.err);
+		break;
 
-			uint8_t *ptrAux = strchr(urcPop.buff, ',');
+		case BG_BRINGUP_REQ_QRFTESTMODE:
+			if(result.err != BG_OK)
+			{
+				bg_bringup_fail(BG_BRINGUP_POWER, result.err);
+				break;
+			}
 
-			if(ptrAux == NULL)
-				return;	
+			printf("|--- POWER ON... OK ---|\n\n");
+			bgModuleInit = 1;
+			bg_bringup_finish(BG_BRINGUP_POWER);
+		break;
 
-			ptrAux = strchr(++ptrAux, ',');
+		case BG_BRINGUP_REQ_CPIN:
+			//sin SIM responde +CME ERROR: 10, se sigue consultando hasta el timeout de la etapa
+			if(result.err == BG_OK && result.info != NULL && strstr(result.info, "READY"))
+				bg_bringup_finish(BG_BRINGUP_SIM);
+		break;
 
-			COPY_PARSE_STR(infoUrc.buff, sizeof(infoUrc.buff), ptrAux, ',', ',');
-			infoUrc.serverID = atoi(infoUrc.buff);
+		case BG_BRINGUP_REQ_CEREG:
+		{
+			//+CEREG: <n>,<stat>[,...] registrado en 1 (red local) o 5 (roaming)
+			uint8_t *parsePtr = (result.err == BG_OK && result.info != NULL) ? strchr(result.info, ',') : NULL;
 
-			infoUrc.type = urcPop.type;
-			bg_urc_parsed_callback(infoUrc);
+			if(parsePtr != NULL && (atoi(parsePtr + 1) == 1 || atoi(parsePtr + 1) == 5))
+				bg_bringup_finish(BG_BRINGUP_ATTACH);
+		}
 		break;
 
-		case BG_URC_RECV:
-			COPY_PARSE_STR(infoUrc.buff, sizeof(infoUrc.buff), urcPop.buff, ',', '\n');
-			infoUrc.connectID = atoi(infoUrc.buff);
-			urcInfoData_t aux = infoUrc;
-			memset(infoUrc.buff, '\0', sizeof(infoUrc.buff));
+		case BG_BRINGUP_REQ_COPS:
+			//si falla se sigue esperando el registro automatico con +CEREG hasta el timeout de la etapa
+			if(result.err == BG_OK)
+				bg_bringup_finish(BG_BRINGUP_ATTACH);
+		break;
 
-			if(bg_receive_buffAMode(infoUrc.connectID, infoUrc.buff, &infoUrc.len) != BG_OK_RECEIVE)
-				return;
+		case BG_BRINGUP_REQ_QICSGP:
+			if(result.err == BG_OK)
+				bg_bringup_finish(BG_BRINGUP_PDP_CONF);
+			else
+				bg_bringup_fail(BG_BRINGUP_PDP_CONF, BG_ERR_CONF_PDP);
+		break;
 
-			infoUrc.type = urcPop.type;
+		case BG_BRINGUP_REQ_QIACT:
+			//AT+QIACT responde ERROR si el contexto ya estaba activo, el estado real se consulta con AT+QIACT?
+			if(result.err == BG_OK)
+			{
+				bgPdpTbl[bgBringup.cfg->pdp.ctxtID - BG_CONTEXT_ID_MIN].active = 1;
+				bgPdpTbl[bgBringup.cfg->pdp.ctxtID - BG_CONTEXT_ID_MIN].updatedMs = bg_get_tick_ms();
+				bg_bringup_finish(BG_BRINGUP_PDP_ACT);
+			}
+			else if(BG_IS_AT_ERR(result.err))
+				bgBringup.pdpQuery = 1;
+			else
+				bg_bringup_fail(BG_BRINGUP_PDP_ACT, BG_ERR_ACT_PDP);
+		break;
 
-			if(infoUrc.len > 1024) infoUrc.len = 1024; 
+		case BG_BRINGUP_REQ_QIACT_QUERY:
+			if(result.err == BG_OK)
+				bg_pdp_parse_qiact(result.resp);
 
-			bg_urc_parsed_callback(infoUrc);
+			if(result.err == BG_OK && bgPdpTbl[bgBringup.cfg->pdp.ctxtID - BG_CONTEXT_ID_MIN].active)
+				bg_bringup_finish(BG_BRINGUP_PDP_ACT);
+			else
+				bg_bringup_fail(BG_BRINGUP_PDP_ACT, BG_ERR_ACT_PDP);
 		break;
+	}
+}
 
-		case BG_URC_INCOMING_FULL:
-			LOG_BG(LE, "URC INCOMMING_FULL\n");
-			infoUrc.type = urcPop.type;
-			bg_urc_parsed_callback(infoUrc);
-			//solo notificar evento
+static void bg_bringup_urc(const urcInfoData_t *infoUrc)
+{
+	const bg_bringupCfg_t *cfg = bgBringup.cfg;
+
+	if(cfg == NULL || bgBringup.stats.stage >= BG_BRINGUP_DONE)
+		return;
+
+	switch(infoUrc->type)
+	{
+		case BG_URC_CPIN:
+			if(infoUrc->result)
+				bg_bringup_finish(BG_BRINGUP_SIM);
 		break;
 
-		case BG_URC_PDP_DEACT:
-			LOG_BG(LE, "URC PDP_DEACT\n");
-			COPY_PARSE_STR(infoUrc.buff, sizeof(infoUrc.buff), urcPop.buff, ',', '\n');
-			infoUrc.contextID = atoi(infoUrc.buff);
-			infoUrc.type = urcPop.type;
-			bg_urc_parsed_callback(infoUrc);
+		case BG_URC_CEREG:
+			if(infoUrc->result == 1 || infoUrc->result == 5)
+				bg_bringup_finish(BG_BRINGUP_ATTACH);
 		break;
 
-		case BG_URC_NO_CARRIER:
+		case BG_URC_QIOPEN:
+			for(uint8_t i = 0; i < cfg->nSckt; i++)
 			{
-				bg_infoTM_t infoTM = bg_getter_transparentMode();
-				bg_close_sckt(infoTM.connectID);
+				if(cfg->sckt[i].connectID != infoUrc->connectID || !(bgBringup.scktSent & (1U << i)))
+					continue;
+
+				if(infoUrc->result != 0)
+				{
+					bg_bringup_fail(BG_BRINGUP_SOCKETS, BG_ERR_OPEN_SCKT);
+					return;
+				}
+
+				bgBringup.scktOpen |= 1U << i;
 			}
 		break;
 	}
 }
-//---------------------------Callbacks MCU para LIB end----------------------------
+//-----------------------------------Arranque de red end-----------------------------
 
 
-//--------------------------Funciones para conteo de tiempo------------------------
-static void bg_start_timeout(void)
+//-----------------------Funciones de cierre y desactivacion-------------------------
+bg_err_t bg_exit_transparent_mode(void)
 {
-	flg_tout_bg = 0;
-	count_sec_bg = 0;
-}
+	//el modulo no esta en modo datos (nunca entro o ya llego NO CARRIER), "+++" no se reconoceria en modo comando
+	if(!bgTmDataMode)
+		return BG_OK_EXIT_TRANSPARENT_MODE;
 
-static uint32_t bg_stop_timeout(void)
-{
-	flg_tout_bg = 1;
-	return count_sec_bg;
-}
-//--------------------------Funciones para conteo de tiempo------------------------
+	//"+++" solo se reconoce si no se envio nada durante el tiempo de guarda, solo se espera lo que falta
+	uint32_t guardEnd = bgTmLastTx + BG_TM_GUARD_MS;
 
+	while(!bgDtrPin && !BG_DEADLINE_REACHED(bg_get_tick_ms(), guardEnd))
+	{
+		bg_rx_process();
 
-//------------------Funciones basicas y de configuracion de modulo------------------
-bg_err_t bg_send(uint32_t timeout, uint8_t enablePrint, const char *fmt, ...) {
-	int format_result = -1, err = -1;
-	char tmp[512] = {'\0'};
-	static uint32_t seq = 0;
-	uint8_t *frame[] = {"************************\n", "~~~~~~~~~~~~~~~~~~~~~~~\n"};
+		//llego NO CARRIER durante la espera, el modulo ya esta en modo comando
+		if(!bgTmDataMode)
+			return BG_OK_EXIT_TRANSPARENT_MODE;
 
-	va_list args;
-	va_start(args, fmt);
-	format_result = vsnprintf(tmp, sizeof tmp, fmt, args);
-	va_end(args);
+		bg_wait_event(guardEnd);
+	}
 
-	if (0 > format_result)
-		return err;
+	bgTmDataMode = 0;
 
-	else
+	//a partir de "+++" (o del flanco de DTR) lo que responda el modulo se tokeniza como modo comando
+	bg_infoTM_t infoTM = bg_getter_transparentMode();
+	bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = infoTM.statusNoCarrier,\
+		.connectID = infoTM.connectID};
+	bg_resp_reset();
+	bg_setter_transparentMode(valueTM);
+
+	if(bgDtrPin)
 	{
-		tmp[format_result] = '\r';
-		tmp[format_result + 1] = '\n';
+		bgGpioWrite(BG_DTR_PIN, 0);
+		bgDelay(BG_DTR_PULSE_MS);
+		bgGpioWrite(BG_DTR_PIN, 1);
+	}
 
-		flg_uart_bg = 0;
-		memset(uBg.buff, '\0', sizeof(uBg.buff));
+	else if(bgUartTx("+++", 3))
+	{
+		LOG_BG(LE, "[BG_ERR] ERROR MCU TX UART\n");
+		return BG_ERR_MCU_TX_UART;
+	}
 
-		LOG_BG(enablePrint, "%s", (seq%2) ? frame[0] : frame[1]);
-		LOG_BG(enablePrint, "MCU[%ld] > \n%s\n", seq, tmp);
-		if(bgUartTx(tmp, strlen(tmp)))
-		{
-			LOG_BG(enablePrint, "[BG_ERR] ERROR MCU TX UART\n");
-			return BG_ERR_MCU_TX_UART;
-		}
+	//el OK llega al terminar el tiempo de guarda posterior a "+++", se detecta en cuanto se tokeniza
+	CHECK_EXIT_TM_ANSW(BG_TIMEOUT_ANSW_OK);
+	LOG_BG(LE, "EXIT TM CHECKED\n");
 
-		bg_start_timeout();
-		while(!flg_uart_bg && count_sec_bg < timeout)
-			__asm__("nop");
+	return BG_OK_EXIT_TRANSPARENT_MODE;
+}
 
-		if(timeout <= bg_stop_timeout())
-		{
-			LOG_BG(enablePrint, "[BG_ERR] TIMEOUT RESPUESTA BG\n");
-			LOG_BG(enablePrint, "%s\n", (seq%2) ? frame[0] : frame[1]);
-			seq++;
-			return BG_ERR_TIMEOUT_ANS;
-		}
+bg_err_t bg_close_sckt(uint8_t connectID)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
+	//lo pendiente del envio agrupado se encola antes de AT+QICLOSE
+	bg_tx_coalesce_flush(connectID, &bgTxCoalesce[connectID].stats.flushExplicit, 1);
 
-		LOG_BG(enablePrint, "BG[%ld] > \n", seq);
-		LOG_BG(enablePrint, "%s\nlen: %ld\n", &uBg.buff[2], uBg.len);
-		LOG_BG(enablePrint, "%s\n", (seq%2) ? frame[0] : frame[1]);
+	bg_err_t err = bg_send(30000, LE, "AT+QICLOSE=%d", connectID);
+	CHECK_BG_ERR(err);
 
-		seq++;
-		memset(uBgUrc.buff, '\0', sizeof(uBgUrc.buff));
-		return BG_OK;
-	}
+	bg_sckt_set_state(connectID, BG_SCKT_STATE_INITIAL);
+
+	//el connectID queda libre para bg_alloc_connect_id() y fuera del pool
+	bgConnectIDMap &= ~(1U << connectID);
+	memset(&bgPool[connectID], 0, sizeof(bgPool[connectID]));
 
+	return BG_OK_CONNECT_ID_CLOSED;
 }
 
-bg_err_t bg_power_on(void)
+bg_err_t bg_detach(void)
 {
-	bg_err_t err = BG_OK;
-	bgGpioWrite(BG_PWRKEY_PIN, 1);
-	bgGpioWrite(BG_RESET_PIN, 1);
-	bgDelay(2000);
-	bgGpioWrite(BG_PWRKEY_PIN, 0);
-	bgGpioWrite(BG_RESET_PIN, 0);
-	bgDelay(6000);
-
-	err = bg_send(5, LE, "AT");
+	bg_err_t err = bg_send(90000, LE, "AT+COPS=2");
 	CHECK_BG_ERR(err);
 
-	CHECK_DESIRED_ANSW(uBg.buff, "OK", BG_TIMEOUT_ANSW_OK);
-	
-	return BG_OK;
+	CHECK_DESIRED_ANSW(BG_TOKEN_MASK(BG_TOK_OK), BG_TIMEOUT_ANSW_OK);
+
+	return BG_OK_DETACH;
 }
+//-----------------------Funciones de cierre y desactivacion end---------------------
 
-bg_err_t bg_power_off(void)
-{
-	bg_err_t err = BG_OK;
 
-	bgDelay(500); //1000 1s
-	
-	err = bg_send(5, LE, "AT+QPOWD");
-	CHECK_BG_ERR(err);
+//----------------------Funciones de transmision recepcion de mensajes---------------
+bg_err_t bg_transmit_buffAMode(uint8_t connectID, uint8_t *data, uint16_t len)
+{
+	if(data == NULL) return BG_ERR_MCU_PTR_NULL;
 
-	CHECK_POWDWN_ANSW(uBg.buff, BG_TIMEOUT_ANSW_OK);
+	bg_iovec_t seg = {.base = data, .len = len};
 
-	bgDelay(3000); //10000 10s
-	return BG_OK;
+	return bg_transmit_buffAMode_iov(connectID, &seg, 1);
 }
 
-static bg_err_t bg_config_module(void){
-
-	static uint8_t configDone = 0;
-
-	if(configDone)
-		return BG_OK;
+bg_err_t bg_transmit_buffAMode_iov(uint8_t connectID, const bg_iovec_t *iov, uint8_t iovCnt)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
-	uint32_t timeout[] = {5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
-	uint8_t *atCmd[] = {"ATE0",//Deshabilita el modo echo del modulo 
-		"AT+QURCCFG=\"urcport\",\"uart1\"",//Configura UART1 para salida de URC
-		"AT+QCFG=\"risignaltype\",\"respective\"",//Se activa señal en pin MAIN_RI
-		"AT+QCFG=\"urc/ri/ring\",\"off\"",//Se desactiva URC de llamadas
-		"AT+QCFG=\"urc/ri/smsincoming\",\"off\"",//Se desactiva URC SMS
-		"AT+QCFG=\"urc/ri/other\",\"pulse\",80,1",//Configura un unico pulso de MAIN_RI a 80ms
-		"AT+QCFG=\"urc/delay\",100",//No hay retardo (0 en vez de 100 )despues del pulso para salida de URC en UART
-		"AT+CEREG=2",//Activa URC de estado de registro en red y ubicacion
-		"AT+QCFG=\"nwscanseq\",020301",//Especifica secuencia de busqueda LTE
-		"AT+QCFG=\"iotopmode\",2,1",//Configura la categoria de busqueda
-		"AT+QCFG=\"band\", 0,800000A,1",//Habilita busqueda de bandas B2, B4 y B28
-		"AT+COPS=3, 2",// Configura respuesta de formato de COPS a numerica
-		"AT&W0"//Guarda la configuracion
-	};
+	if(iov == NULL) return BG_ERR_MCU_PTR_NULL;
 
-	bg_err_t err = BG_OK;
+	uint32_t len = 0;
 
-	for(int i = 0; i < sizeof(atCmd) / sizeof(atCmd[0]); i++)
+	for(uint8_t i = 0; i < iovCnt; i++)
 	{
-		err = bg_send(timeout[i], LE, atCmd[i]);
-		CHECK_BG_ERR(err);
+		if(iov[i].base == NULL && iov[i].len > 0) return BG_ERR_MCU_PTR_NULL;
+		len += iov[i].len;
 	}
 
-	configDone = 1;
+	if(bgTxCoalesce[connectID].threshold > 0)
+		return bg_tx_coalesce_write(connectID, iov, iovCnt);
 
-	return err;
-}
+	if(len > BG_QISEND_MAX_LEN) return BG_ERR_SEND_LEN;
 
-bg_err_t bg_init_module(void)
-{	
-	static uint8_t flgInit = 0;
-	
-	if(flgInit) return BG_OK;
+	//el mensaje se transmite al recibir el prompt '>' y se espera la confirmacion de envio
+	bg_err_t err = bg_send_data(BG_TIMEOUT_ANSW_OK_LONG, LE, iov, iovCnt, "AT+QISEND=%d,%ld", connectID, len);
+	CHECK_BG_ERR(err);
 
-	while(bg_power_on() != BG_OK)
+	if(!(bgRxTokens & BG_TOKEN_MASK(BG_TOK_SEND_OK)))
 	{
-		uint8_t attmp = 0;
-		printf("POWER ON... ATTEMP: %d\n", attmp);
-		if(attmp++ > 2)
-		  bgResetMCU();
+		LOG_BG(LE, "[BG_ERR] MENSAJE NO ENVIADO\n");
+		return BG_ERR_TIMEOUT_ANS_DESIRED;
 	}
 
-	bg_power_off();
+	bgScktTbl[connectID].txBytes += len;
 
-	while(bg_power_on() != BG_OK)
-	{
-		uint8_t attmp = 0;
-		printf("POWER ON... ATTEMP: %d\n", attmp);
-		if(attmp++ > 2)
-		  bgResetMCU();
-	}
+	return BG_OK_TRANSMIT;
+}
 
-	printf("|--- POWER ON... OK ---|\n\n");
+bg_err_t bg_receive_buffAMode(uint8_t connectID, uint8_t *buff, uint16_t *len)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
-	create_queue(&bgUrcQueue);
+	if(buff == NULL || len == NULL) return BG_ERR_MCU_PTR_NULL;
 
-	bg_err_t err = bg_config_module();
+	uint8_t *data = NULL;
+	uint32_t rdLen = 0;
+
+	*len = 0;
+
+	bg_err_t err = bg_qird(connectID, BG_QIRD_CHUNK_LEN, &data, &rdLen, NULL);
 	CHECK_BG_ERR(err);
 
-	return bg_send(10, LE, "AT+QRFTESTMODE=0");
-}
-//------------------Funciones basicas y de configuracion de modulo------------------
+	memcpy(buff, data, rdLen);
+	*len = rdLen;
 
+	return BG_OK_RECEIVE;
+}
 
-//---------------------------------Funciones de consulta-----------------------------
-bg_err_t bg_data_module(void)
+bg_err_t bg_receive_udp(uint8_t connectID, uint8_t *buff, uint16_t *len, bg_udpAddr_t *from)
 {
-	uint8_t FW[50] = {'\0'}, ICCID[50] = {'\0'}, IMEI[50] = {'\0'}, *parsePtr;
-	uint8_t *dataPtr[] = {FW, ICCID, IMEI};	
-	size_t sizeBuff[] = {sizeof(FW), sizeof(ICCID), sizeof(IMEI)};
-
-	uint32_t timeout[] = {5, 5, 5};
-	uint8_t *atCmd[] = {"AT+GMR",//Consulta el Fw del modulo
-		"AT+QCCID",//Consulta del ICCID del SIM
-		"AT+GSN"//Consulta IMEI
-	};
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
-	uint8_t chrDelim[] = {'\n', ' ', '\n'};
+	if(buff == NULL || len == NULL) return BG_ERR_MCU_PTR_NULL;
 
-	bg_err_t err = BG_OK;
+	uint8_t *data = NULL;
+	uint32_t rdLen = 0;
 
-	for(int i = 0; i < sizeof(atCmd) / sizeof(atCmd[0]); i++)
-	{
-		err = bg_send(timeout[i], LE, atCmd[i]);
-		CHECK_BG_ERR(err);
+	*len = 0;
 
-		COPY_PARSE_STR(dataPtr[i], sizeBuff[i], uBg.buff, chrDelim[i], '\n');
-	}
+	bg_err_t err = bg_qird(connectID, BG_QIRD_UDP_LEN, &data, &rdLen, from);
+	CHECK_BG_ERR(err);
 
-	LOG_BG(LE, "FW: %s\nICCID: %s\nIMEI: %s\n", FW, ICCID, IMEI);
+	memcpy(buff, data, rdLen);
+	*len = rdLen;
 
-	return err;
+	return BG_OK_RECEIVE;
 }
 
-bg_err_t bg_check_sim(void)
+bg_err_t bg_receive_stream(uint8_t connectID, bg_recvSink_t sink, void *ctx, uint32_t *total)
 {
-	bg_err_t err;
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
-	for(size_t attmp = 0; attmp <= 3; attmp++)
+	if(sink == NULL) return BG_ERR_MCU_PTR_NULL;
+
+	uint32_t rdTotal = 0;
+	bg_err_t err = BG_OK;
+
+	//en UDP cada lectura es un datagrama, se pide completo para no truncarlo
+	bg_scktService_t service = bgScktTbl[connectID].service;
+	uint16_t reqLen = (service == BG_SCKT_SERVICE_UDP || service == BG_SCKT_SERVICE_UDP_SERVICE) ? BG_QIRD_UDP_LEN :\
+		BG_QIRD_CHUNK_LEN;
+
+	if(total != NULL) *total = 0;
+
+	while(1)
 	{
-		if(attmp >= 3) return BG_ERR_SIM_NO_OK;
+		uint8_t *data = NULL;
+		uint32_t rdLen = 0;
 
-		err = bg_send(5, LE, "AT+CPIN?");
-		CHECK_BG_ERR(err);
+		err = bg_qird(connectID, reqLen, &data, &rdLen, NULL);
+		if(err != BG_OK) break;
 
-		if(strstr(uBg.buff, "READY")) break;
-	}
+		if(rdLen == 0) break;
 
-	return BG_OK_SIM;
-}
+		sink(connectID, data, rdLen, ctx);
+		rdTotal += rdLen;
 
-bg_err_t bg_check_attach(void)
-{
-	bg_err_t err = bg_send(10, LE, "AT+CEREG?");
-	CHECK_BG_ERR(err);
+		if(total != NULL) *total = rdTotal;
 
-	uint8_t *parsePtr = strchr(uBg.buff, ',');
+		//un bloque completo indica que probablemente hay mas, solo se consulta cuando el bloque vino corto
+		if(rdLen == reqLen) continue;
 
-	if(parsePtr == NULL) return BG_ERR_PARSE;
+		uint32_t unread = 0;
 
-	if(*(parsePtr + 1) == '5' || *(parsePtr + 1) == '1') return BG_OK_ATTACH; //registrado 1 o 5 +CEREG: 0,5,
+		err = bg_qird(connectID, 0, NULL, &unread, NULL);
+		if(err != BG_OK || unread == 0) break;
+	}
 
-	return BG_ERR_ATTACH_NO_OK;
+	LOG_BG(LD, "[BG_LOG] QIRD connectID: %d bytes: %lu\n", connectID, rdTotal);
+
+	return (err == BG_OK) ? BG_OK_RECEIVE : err;
 }
 
-bg_err_t bg_query_cops(void)
+static bg_err_t bg_qird(uint8_t connectID, uint16_t reqLen, uint8_t **data, uint32_t *len, bg_udpAddr_t *from)
 {
-	bg_err_t err = bg_send(10, LE, "AT+COPS?");
+	*len = 0;
+
+	bg_err_t err = bg_send(15000, LD, "AT+QIRD=%d,%d", connectID, reqLen);
 	CHECK_BG_ERR(err);
 
-	uint8_t *parsePtr = uBg.buff;
+	//+QIRD: <read_actual_length>[,"<remoteIP>",<remote_port>]\r\n<data> o
+	//+QIRD: <total_receive_length>,<have_read_length>,<unread_length>
+	uint8_t *parsePtr = strstr(bgResp.buff, "+QIRD: ");
 
-	if(strchr(parsePtr, ',') == NULL) return BG_ERR_NO_OPER;
+	if(parsePtr == NULL)
+	{
+		LOG_BG(LE, "[BG_ERR] RESPUESTA AT+QIRD SIN +QIRD\n");
+		return BG_ERR_PARSE;
+	}
 
-	uint8_t mode[10] = {'\0'}, oper[20] = {'\0'}, accessTech[10] = {'\0'};
-	uint8_t *dataBuff[] = {mode, NULL, oper, accessTech};
-	size_t sizeBuff[] = {sizeof(mode), 0, sizeof(oper), sizeof(accessTech)};
-	uint8_t chrDelim1[] = {' ', ',', ',', ','};
-	uint8_t chrDelim2[] = {',', ',', ',', '\n'};
+	if(reqLen == 0)
+	{
+		uint8_t *unreadPtr = strrchr(parsePtr, ',');
 
-	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+		if(unreadPtr == NULL) return BG_ERR_PARSE;
+
+		*len = strtoul(unreadPtr + 1, NULL, 10);
+		return BG_OK;
+	}
+
+	uint32_t rdLen = strtoul(parsePtr + 7, NULL, 10);
+	uint8_t *dataPtr = strchr(parsePtr, '\n');
+
+	if(rdLen > reqLen || dataPtr == NULL || (dataPtr + 1 + rdLen) > &bgResp.buff[bgResp.len])
 	{
-		parsePtr = strchr(parsePtr, chrDelim1[i]);
-		if(parsePtr)
-		{
-			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
-			parsePtr++;
-		}
+		LOG_BG(LE, "[BG_ERR] AT+QIRD INCOMPLETO (%lu bytes)\n", rdLen);
+		return BG_ERR_PARSE;
 	}
-	
-	uint8_t *strMode[] = {"Auto", "Manual", "Desregistrado Manual", "", "Manual-Auto"},\
-			*strAccss[] = {"GSM", "", "", "", "", "", "", "E-ULTRAN", "eMTC", "MB-IoT"};
 
-	printf("mode: %s\noper: %s\naccss: %s\n", strMode[atoi(mode)], oper,\
-			strAccss[atoi(accessTech)]);
+	*data = dataPtr + 1;
+	*len = rdLen;
+	bgScktTbl[connectID].rxBytes += rdLen;
+
+	if(from == NULL) return BG_OK;
+
+	//en UDP SERVICE la linea trae la direccion de origen del datagrama
+	uint8_t *ipPtr = strchr(parsePtr, '"');
+
+	memset(from, 0, sizeof(*from));
+
+	if(ipPtr == NULL || ipPtr > dataPtr) return BG_OK;
+
+	uint8_t *ipEnd = strchr(++ipPtr, '"');
+
+	if(ipEnd == NULL || ipEnd > dataPtr) return BG_OK;
+
+	uint16_t ipLen = (ipEnd - ipPtr < BG_SCKT_IP_LEN) ? ipEnd - ipPtr : BG_SCKT_IP_LEN - 1;
+	memcpy(from->ip, ipPtr, ipLen);
+
+	if(*(ipEnd + 1) == ',')
+		from->port = atoi(ipEnd + 2);
 
 	return BG_OK;
 }
 
-bg_err_t bg_query_conf_pdp(uint8_t contextID)
+static uint8_t bg_recv_push(void)
 {
-	if(contextID > BG_CONTEXT_ID_MAX || contextID < BG_CONTEXT_ID_MIN)
-		return BG_ERR_CTXT_ID_UNSUPPORTED;
+	urcRawData_t push;
 
-	bg_err_t err = bg_send(40, LD, "AT+QICSGP=%d", contextID);
-	CHECK_BG_ERR(err);
+	if(!bgPushQueue.peek(&bgPushQueue, &push))
+		return 0;
 
-	uint8_t *parsePtr = uBg.buff;
+	urcInfoData_t infoUrc = {.buff = {'\0'}, .len = 0, .type = BG_URC_RECV};
 
-	if(strchr(parsePtr, ',') == NULL) return BG_ERR_NO_OPER;
+	bg_recv_urc_sink(push.type, push.buff, push.len, &infoUrc);
 
-	uint8_t apn[256] = {'\0'}, usr[100] = {'\0'}, passw[100] = {'\0'}, auth[100] = {'\0'};
-	uint8_t *dataBuff[] = {apn, usr, passw, auth};
-	size_t sizeBuff[] = {sizeof(apn), sizeof(usr), sizeof(passw), sizeof(auth)};
-	uint8_t chrDelim1[] = {',', ',', ',', ','};
-	uint8_t chrDelim2[] = {',', ',', ',', '\n'};
+	bgPushQueue.release(&bgPushQueue);
 
-	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+	return 1;
+}
+
+static void bg_recv_urc_sink(uint8_t connectID, const uint8_t *data, uint16_t len, void *ctx)
+{
+	urcInfoData_t *infoUrc = (urcInfoData_t *)ctx;
+
+	//los bloques mayores a urcInfoData_t.buff (direct push o un datagrama UDP) se entregan en partes
+	for(uint16_t off = 0; off < len; off += sizeof(infoUrc->buff))
 	{
-		parsePtr = strchr(parsePtr, ',');
-		
-		if(parsePtr)
-		{
-			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
-			parsePtr++;
-		}
+		uint16_t n = (len - off < sizeof(infoUrc->buff)) ? len - off : sizeof(infoUrc->buff);
+
+		memcpy(infoUrc->buff, &data[off], n);
+		infoUrc->len = n;
+		infoUrc->connectID = connectID;
+
+		bg_urc_parsed_callback(*infoUrc);
 	}
-	
-	LOG_BG(LE, "APN: %s\nUser: %s\nPassword: %s\nAuth: %s\n", apn, usr, passw, auth);
+}
+
+bg_err_t bg_set_tx_coalesce(uint8_t connectID, uint16_t threshold, uint32_t flushMs)
+{
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+
+	bg_txCoalesce_t *co = &bgTxCoalesce[connectID];
+
+	if(threshold == 0)
+		bg_tx_coalesce_flush(connectID, &co->stats.flushExplicit, 1);
+
+	co->threshold = (threshold < BG_QISEND_MAX_LEN) ? threshold : BG_QISEND_MAX_LEN;
+	co->flushMs = flushMs;
 
 	return BG_OK;
 }
 
-bg_err_t bg_check_pdp(uint8_t ctxtID)
+bg_err_t bg_flush_buffAMode(uint8_t connectID)
 {
-	if(ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN) return BG_ERR_CTXT_ID_UNSUPPORTED;
-	bg_err_t err = bg_send(10, LD, "AT+QIACT?");
-	CHECK_BG_ERR(err);
-	uint8_t *parsePtr = uBg.buff;
-	uint8_t *buffAux = NULL;
-	sprintf(buffAux, "+QIACT: %d", ctxtID); 
-	if(!strstr(parsePtr, buffAux)) return BG_OK_PDP_DEACT;
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
+	bg_txCoalesce_t *co = &bgTxCoalesce[connectID];
 
-	uint8_t ctxState[20] = {'\0'}, ctxtType[20] = {'\0'}, ip[30] = {'\0'};
-	uint8_t *dataBuff[] = {ctxState, ctxtType, ip};
-	size_t sizeBuff[] = {sizeof(ctxState), sizeof(ctxtType), sizeof(ip)};
-	uint8_t chrDelim1[] = {',', ',', ','};
-	uint8_t chrDelim2[] = {',', ',', '\n'};
+	bg_err_t err = bg_tx_coalesce_flush(connectID, &co->stats.flushExplicit, 1);
+	CHECK_BG_ERR(err);
 
-	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+	//se espera el SEND OK de todos los buffers del socket (tambien los que ya estaban en curso)
+	for(uint8_t i = 0; i < BG_TX_POOL_LEN; i++)
 	{
-		parsePtr = strchr(parsePtr, ',');
-		
-		if(parsePtr)
+		while(bgTxPool[i].state == BG_TX_BUFF_SENDING && bgTxPool[i].connectID == connectID)
 		{
-			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
-			parsePtr++;
+			bg_poll();
+			bg_wait_event(bgCmdDeadline);
 		}
 	}
 
-	uint8_t *strCtxtState[] = {"Desactivado", "Activado"},\
-		*strCtxtType[] = {"", "IPv4", "IPv6", "IPv4v6"};
+	//el error se reporta una sola vez
+	err = co->lastErr;
+	co->lastErr = BG_OK;
 
-	LOG_BG(LE, "ctxState: %s\nctxtType: %s\nip: %s\n", strCtxtState[atoi(ctxState)], strCtxtType[atoi(ctxtType)], ip);
+	return (err == BG_OK) ? BG_OK_TRANSMIT : err;
+}
 
-	if(!strchr(ctxState, '1')) return BG_OK_PDP_DEACT;
+bg_txCoalesceStats_t bg_get_tx_coalesce_stats(uint8_t connectID)
+{
+	bg_txCoalesceStats_t stats = {0};
 
-	return BG_OK_PDP_ACT;
+	if(connectID <= BG_CONNECT_ID_MAX)
+		stats = bgTxCoalesce[connectID].stats;
+
+	return stats;
 }
 
-bg_err_t bg_check_sckt(uint8_t connectID)
+static bg_err_t bg_tx_coalesce_write(uint8_t connectID, const bg_iovec_t *iov, uint8_t iovCnt)
 {
-	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
-	bg_err_t err = bg_send(10, LE, "AT+QISTATE=1,%d", connectID);
-	CHECK_BG_ERR(err);
+	bg_txCoalesce_t *co = &bgTxCoalesce[connectID];
+	uint32_t len = 0;
 
-	uint8_t strConnectID[10] = {'\0'};
-	sprintf(strConnectID, " %d", connectID);
-	
-	uint8_t *parsePtr = uBg.buff;
+	for(uint8_t i = 0; i < iovCnt; i++)
+		len += iov[i].len;
 
-	if(!strstr(parsePtr, strConnectID)) return BG_OK_CONNECT_ID_CLOSED;//BG_ERR_CONNECT_ID_NOT_USED;
+	co->stats.writes++;
+	co->stats.bytes += len;
 
-	//+QISTATE: <connectID>,<service_type>,<IP_address>,<remote_port>,<local_port>,<socket_state>,<contextID>,<serverID>,<access_mode>,<AT_port>
+	//si no cabe completo se envia lo pendiente para no partir el mensaje en dos AT+QISEND
+	if(co->buff != NULL && co->buff->len + len > BG_QISEND_MAX_LEN)
+	{
+		bg_err_t err = bg_tx_coalesce_flush(connectID, &co->stats.flushThreshold, 1);
+		CHECK_BG_ERR(err);
+	}
 
-	uint8_t serviceType[20] = {'\0'}, ip[30] = {'\0'}, remotePort[10] = {'\0'}, localPort[10] = {'\0'},\
-			scktState[10] = {'\0'};
-	uint8_t *dataBuff[] = {serviceType, ip, remotePort, localPort, scktState};
-	size_t sizeBuff[] = {sizeof(serviceType), sizeof(ip), sizeof(remotePort),\
-			sizeof(localPort), sizeof(scktState)};
-	uint8_t chrDelim1[] = {',', ',', ',', ',',','};
-	uint8_t chrDelim2[] = {',', ',', ',', ',',','};
+	const uint8_t *data = (iovCnt > 0) ? iov[0].base : NULL;
+	uint16_t segLen = (iovCnt > 0) ? iov[0].len : 0;
+	uint8_t seg = 0;
 
-	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
+	while(len > 0)
 	{
-		parsePtr = strchr(parsePtr, ',');
-		
-		if(parsePtr)
+		//siguiente segmento del mensaje
+		if(segLen == 0)
 		{
-			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
-			parsePtr++;
+			seg++;
+			data = iov[seg].base;
+			segLen = iov[seg].len;
+			continue;
 		}
-	}
 
-	uint8_t *strScktState[] = {"Inicial", "Abriendo", "Conectado", "Escuchando",\
-			"Cerrando"};
-	printf("serviceType: %s\nip: %s\nremotePort: %s\nlocalPort: %s\nscktState: %s\n", serviceType,\
-		ip, remotePort, localPort, strScktState[atoi(scktState)]);
+		while(co->buff == NULL)
+		{
+			uint8_t sending = 0;
 
-	if(strchr(scktState, '4') || strchr(scktState, '0')) return BG_OK_CONNECT_ID_CLOSED; 
+			for(uint8_t i = 0; i < BG_TX_POOL_LEN && co->buff == NULL; i++)
+			{
+				if(bgTxPool[i].state == BG_TX_BUFF_FREE)
+				{
+					co->buff = &bgTxPool[i];
+					co->buff->state = BG_TX_BUFF_FILLING;
+					co->buff->connectID = connectID;
+					co->buff->len = 0;
+					co->buff->flushAt = bg_get_tick_ms() + co->flushMs;
+				}
+
+				sending |= (bgTxPool[i].state == BG_TX_BUFF_SENDING);
+			}
 
-	return BG_OK_CONNECT_ID_OPENNED;
-}
+			if(co->buff != NULL) break;
 
-bg_err_t bg_query_signal(void)
-{
-	bg_err_t err = bg_send(10, LE, "AT+QCSQ");
-	CHECK_BG_ERR(err);
+			//todos los buffers estan en llenado (ej. en modo transparente no se envian), no hay que esperar
+			if(!sending)
+			{
+				LOG_BG(LE, "[BG_ERR] SIN BUFFER LIBRE DE ENVIO AGRUPADO\n");
+				return BG_ERR_TX_POOL_FULL;
+			}
 
-	uint8_t *parsePtr = uBg.buff;
+			bg_poll();
+			bg_wait_event(bgCmdDeadline);
+		}
 
-	uint8_t sysMode[20] = {'\0'}, rssi[30] = {'\0'}, rsrp[10] = {'\0'}, sinr[10] = {'\0'},\
-			rsrq[10] = {'\0'};
-	uint8_t *dataBuff[] = {sysMode, rssi, rsrp, sinr, rsrq};
-	size_t sizeBuff[] = {sizeof(sysMode), sizeof(rssi), sizeof(rsrp),\
-			sizeof(sinr), sizeof(rsrq)};
-	uint8_t chrDelim1[] = {' ', ',', ',', ',',','};
-	uint8_t chrDelim2[] = {',', ',', ',', ',','\n'};
+		uint16_t n = BG_QISEND_MAX_LEN - co->buff->len;
 
-	for(int i = 0; i < sizeof(dataBuff) / sizeof(dataBuff[0]); i++)
-	{
-		parsePtr = strchr(parsePtr, chrDelim1[i]);
-		
-		if(parsePtr)
+		if(n > segLen) n = segLen;
+
+		memcpy(&co->buff->data[co->buff->len], data, n);
+		co->buff->len += n;
+		data += n;
+		segLen -= n;
+		len -= n;
+
+		if(co->buff->len >= co->threshold)
 		{
-			COPY_PARSE_STR(dataBuff[i], sizeBuff[i], parsePtr, chrDelim1[i], chrDelim2[i]);
-			parsePtr++;
+			bg_err_t err = bg_tx_coalesce_flush(connectID, &co->stats.flushThreshold, 1);
+			CHECK_BG_ERR(err);
 		}
 	}
 
-	int rssi_int = atoi(rssi);
-	int rsrp_int = atoi(rsrp);
+	return BG_OK_TRANSMIT;
+}
 
-	float sinr_f = (float) atoi(sinr);
-	sinr_f /= 2;
-	sinr_f -= 23.5;
-	int sinr_int = sinr_f;
+static bg_err_t bg_tx_coalesce_flush(uint8_t connectID, uint32_t *counter, uint8_t block)
+{
+	bg_txCoalesce_t *co = &bgTxCoalesce[connectID];
+	bg_txBuff_t *buff = co->buff;
 
-	int rsrq_int = atoi(rsrq);
+	if(buff == NULL || buff->len == 0) return BG_OK;
 
+	while(block && bg_cmd_pending() >= BG_CMD_QUEUE_LEN)
+	{
+		bg_poll();
+		bg_wait_event(bgCmdDeadline);
+	}
 
-	printf("SysMode: %s\nRSSI: %ld\nRSRP: %ld\nSINR: %ld\nRSRQ: %ld\n", sysMode,\
-		rssi_int, rsrp_int, sinr_int, rsrq_int);
+	bg_err_t err = bg_send_data_async(BG_TIMEOUT_ANSW_OK_LONG, buff->data, buff->len, bg_tx_coalesce_callback, buff,\
+		"AT+QISEND=%d,%d", connectID, buff->len);
+	CHECK_BG_ERR(err);
 
-	//if(rsrp_int >= -115 && rsrq_int >= -15 && sinr_int >= 0)
-	if(rsrp_int >= -115 && sinr_int >= 0)
-		return BG_OK_SIGNAL;
+	buff->state = BG_TX_BUFF_SENDING;
+	co->buff = NULL;
+	co->stats.sends++;
+	(*counter)++;
 
-	return BG_ERR_SIGNAL;
+	return BG_OK;
 }
-//---------------------------------Funciones de consulta end-------------------------
-
 
-//-------------------------Funciones de Attach y activacion PDP----------------------
-bg_err_t bg_attach(uint8_t *operator)
+static void bg_tx_coalesce_poll(void)
 {
-	bg_err_t err = BG_ERR_ATTACH_NO_OK;
-	for(int i = 0; i <= 3; i++)
+	//en modo transparente no se pueden enviar comandos AT, se espera a salir
+	if(bg_getter_transparentMode().statusTM == BG_TM_ACTIVE)
+		return;
+
+	for(uint8_t i = 0; i <= BG_CONNECT_ID_MAX; i++)
 	{
-		if(i == 3) return err;
-  
-		if((err = bg_send(180, LE, "AT+COPS=4,2,\"%s\",8", operator)) != BG_OK) continue;//intenta registrarse en la red de un operador para EG915ULA el Act (access technology es 7 E-ULTRAN)
-		
-		if(bg_check_attach() == BG_OK_ATTACH) break;
+		bg_txCoalesce_t *co = &bgTxCoalesce[i];
 
-		err = BG_ERR_ATTACH_NO_OK;
+		if(co->buff != NULL && BG_DEADLINE_REACHED(bg_get_tick_ms(), co->buff->flushAt))
+			if(bg_tx_coalesce_flush(i, &co->stats.flushTimer, 0) != BG_OK)
+				return;
 	}
-
-	return BG_OK_ATTACH;
 }
 
-bg_err_t bg_conf_pdp(bg_ctxPdp_t contextPDP)
+bg_err_t bg_transmit_large(uint8_t connectID, const uint8_t *data, uint32_t len, bg_largeSendStats_t *stats)
 {
-	if(contextPDP.ctxtID > BG_CONTEXT_ID_MAX || contextPDP.ctxtID < BG_CONTEXT_ID_MIN)
-	 return BG_ERR_CTXT_ID_UNSUPPORTED;
+	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
-	bg_err_t err = bg_send(40, LE, "AT+QICSGP=%d,%d,\"%s\",\"%s\",\"%s\",%d",contextPDP.ctxtID,\
-		contextPDP.contextType, contextPDP.apn, contextPDP.usr, contextPDP.psw, contextPDP.auth);
+	if(data == NULL) return BG_ERR_MCU_PTR_NULL;
 
-	CHECK_BG_ERR(err);
+	bg_largeSend_t ls = {.len = len, .err = BG_OK};
+	uint32_t t0 = bg_get_tick_ms();
 
-	if(strstr(uBg.buff, "OK")) return BG_OK_CONF_PDP;
+	//lo que ya estaba en el buffer de envio agrupado va primero
+	bg_tx_coalesce_flush(connectID, &bgTxCoalesce[connectID].stats.flushExplicit, 1);
 
-	return BG_ERR_CONF_PDP;
-}
+	while((ls.err == BG_OK && ls.next < len) || ls.inflight > 0 || ls.query)
+	{
+		uint32_t now = bg_get_tick_ms();
 
-bg_err_t bg_pdp_activation(uint8_t ctxtID, bg_actPdp_t act)
-{
-	if(ctxtID > BG_CONTEXT_ID_MAX || ctxtID < BG_CONTEXT_ID_MIN) 
-	return BG_ERR_CTXT_ID_UNSUPPORTED;
+		//el punto remoto cerro la conexion (+QIURC: "closed"), lo que falta ya no se puede enviar
+		if(ls.err == BG_OK && bgScktTbl[connectID].state == BG_SCKT_STATE_CLOSING)
+			ls.err = BG_ERR_CONNECT_ID_NOT_USED;
 
-	if(act > BG_PDP_ACT_UNSUPORTED) return BG_ERR_ACT_PDP;
+		//se consulta cada mitad de la ventana y, en pausa, cada BG_TX_PACE_MS
+		if(ls.err == BG_OK && ls.next < len && !ls.query && ((!ls.hold && ls.sinceQuery >= BG_TX_UNACKED_MAX / 2) ||\
+			(ls.hold && BG_DEADLINE_REACHED(now, ls.nextQuery))) && bg_cmd_pending() < BG_CMD_QUEUE_LEN)
+		{
+			if(bg_send_async(BG_TIMEOUT_ANSW, bg_large_query_callback, &ls, "AT+QISEND=%d,0", connectID) == BG_OK)
+			{
+				ls.query = 1;
+				ls.sinceQuery = 0;
+			}
+		}
 
-	uint8_t *atCmd[] = {"AT+QIACT=", "AT+QIDEACT="};
+		while(ls.err == BG_OK && !ls.hold && ls.next < len && ls.inflight < BG_TX_PIPELINE_DEPTH &&\
+			bg_cmd_pending() < BG_CMD_QUEUE_LEN)
+		{
+			uint16_t seg = (len - ls.next < BG_QISEND_MAX_LEN) ? len - ls.next : BG_QISEND_MAX_LEN;
 
-	bg_err_t err = bg_send(30, LE, "%s%d", atCmd[act], ctxtID);
-	CHECK_BG_ERR(err);
+			bg_err_t err = bg_send_data_async(BG_TIMEOUT_ANSW_OK_LONG, &data[ls.next], seg, bg_large_send_callback, &ls,\
+				"AT+QISEND=%d,%d", connectID, seg);
 
-	return bg_check_pdp(ctxtID);
-}
-//-------------------------Funciones de Attach y activacion PDP end------------------
+			if(err != BG_OK)
+			{
+				ls.err = err;
+				break;
+			}
 
+			ls.next += seg;
+			ls.sinceQuery += seg;
+			ls.inflight++;
+			ls.stats.segments++;
+		}
 
-//------------------------Funciones de apertura de socket---------------------------
-bg_err_t bg_open_sckt(bgSckt_t sckt)
-{
-	bg_err_t err;
-	uint8_t *strServiceType[] = {"TCP LISTENER", "TCP"};
+		bg_poll();
 
-	if(sckt.serviceType == BG_OPEN_CLIENT)
-		err = bg_send(30, LE, "AT+QIOPEN=%d,%d,\"%s\",\"%s\",%ld,%ld,%d", sckt.ctxtID, sckt.connectID,\
-		strServiceType[sckt.serviceType], sckt.ip, sckt.remotePort, BG_OPEN_CLIENT_LOCAL_PORT, sckt.accssMode);
+		if(ls.inflight > 0 || ls.query)
+			bg_wait_event(bgCmdDeadline);
+		else if(ls.hold)
+			bg_wait_event(ls.nextQuery);
+	}
 
-	else
-		err = bg_send(30, LE, "AT+QIOPEN=%d,%d,\"%s\",\"%s\",%ld,%ld,%d", sckt.ctxtID, sckt.connectID,\
-			strServiceType[sckt.serviceType], BG_OPEN_SERVER_IP, BG_OPEN_SERVER_REMOTE_PORT, sckt.localPort, sckt.accssMode);
+	bgScktTbl[connectID].txBytes += ls.stats.bytes;
 
-	CHECK_BG_ERR(err);
+	//+QISEND: <total_send_length>,<ackedbytes>,<unackedbytes>, los bytes de este envio son los ultimos
+	if(ls.stats.bytes > 0 && bg_send(BG_TIMEOUT_ANSW, LD, "AT+QISEND=%d,0", connectID) == BG_OK)
+	{
+		uint8_t *parsePtr = strstr(bgResp.buff, "+QISEND: ");
+		uint8_t *unackedPtr = (parsePtr != NULL) ? strrchr(parsePtr, ',') : NULL;
 
-	uint8_t openAnsw[20] = {'\0'};
-	sprintf(openAnsw, "+QIOPEN: %d,0", sckt.connectID);
+		if(unackedPtr != NULL)
+		{
+			uint32_t unacked = strtoul(unackedPtr + 1, NULL, 10);
+			ls.stats.acked = (unacked < ls.stats.bytes) ? ls.stats.bytes - unacked : 0;
+		}
+	}
 
-	//CHECK_DESIRED_ANSW(uBg.buff, openAnsw, BG_TIMEOUT_ANSW_OK);
-	CHECK_OPEN_SCKT(uBg.buff, openAnsw, BG_TIMEOUT_ANSW_OK);
-	
-	return bg_check_sckt(sckt.connectID);
-}
+	ls.stats.elapsedMs = bg_get_tick_ms() - t0;
+	ls.stats.goodputBps = (ls.stats.elapsedMs > 0) ? (uint32_t)((uint64_t)ls.stats.bytes * 1000 / ls.stats.elapsedMs) :\
+		ls.stats.bytes;
 
-bg_infoTM_t *bg_getter_instance_TM(void)
-{
-	static bg_infoTM_t infoTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_RESET,
-		 .connectID = 200}; 
-	return &infoTM;
+	LOG_BG(LE, "[BG_LOG] ENVIO GRANDE connectID: %d bytes: %lu/%lu en %lu ms (%lu B/s), segmentos: %d pausas: %d\n",\
+		connectID, ls.stats.bytes, len, ls.stats.elapsedMs, ls.stats.goodputBps, ls.stats.segments, ls.stats.paceWaits);
 
-	//NOTA: el valor de 200 se escoge para no inicializar en alguna conexion soportada (0-11) 
-}
+	if(stats != NULL)
+		*stats = ls.stats;
 
-void bg_setter_transparentMode(bg_infoTM_t value)
-{
-	bg_infoTM_t *infoTM = bg_getter_instance_TM();
-	*infoTM = value;
+	return (ls.err == BG_OK) ? BG_OK_TRANSMIT : ls.err;
 }
 
-bg_infoTM_t bg_getter_transparentMode(void)
+bg_err_t bg_transmit_udp(uint8_t connectID, const uint8_t *ip, uint16_t port, const uint8_t *data, uint16_t len)
 {
-	bg_infoTM_t *infoTM = bg_getter_instance_TM();
-	return *infoTM;
+	bg_udpDgram_t dgram = {.data = data, .len = len, .ip = ip, .port = port};
+
+	return bg_transmit_udp_batch(connectID, &dgram, 1, NULL);
 }
 
-bg_err_t bg_transparent_mode(uint8_t connectID)
+bg_err_t bg_transmit_udp_batch(uint8_t connectID, const bg_udpDgram_t *dgram, uint8_t cnt, uint8_t *sent)
 {
 	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
 
-	bg_infoTM_t infoTM = bg_getter_transparentMode();
-
-	if(infoTM.statusTM == BG_TM_ACTIVE) return BG_OK_TRANSPARENT_MODE;
+	if(dgram == NULL) return BG_ERR_MCU_PTR_NULL;
 
-	bg_err_t err = bg_send(10, LE, "AT+QICFG=\"transwaittm\",%d", connectID); 
-	CHECK_BG_ERR(err);
+	bg_udpBatch_t batch = {.dgram = dgram, .err = BG_OK};
+	uint8_t next = 0;
 
-	err = bg_send(10, LE, "AT+QICFG=\"transwaittm\"");
-	CHECK_BG_ERR(err);
+	while(next < cnt || batch.inflight > 0)
+	{
+		while(next < cnt && batch.inflight < BG_TX_PIPELINE_DEPTH && bg_cmd_pending() < BG_CMD_QUEUE_LEN)
+		{
+			const bg_udpDgram_t *d = &dgram[next++];
+			bg_err_t err;
 
-	err = bg_send(10, LE, "AT+QISWTMD=%d,2", connectID); 
-	CHECK_BG_ERR(err);
+			if(!BG_UDP_DGRAM_OK(d))
+				err = (d->data == NULL) ? BG_ERR_MCU_PTR_NULL : BG_ERR_SEND_LEN;
 
-	CHECK_DESIRED_ANSW(uBg.buff, "CONNECT", BG_TIMEOUT_ANSW_OK);
+			else if(d->ip == NULL)
+				err = bg_send_data_async(BG_TIMEOUT_ANSW_OK_LONG, d->data, d->len, bg_udp_batch_callback, &batch,\
+					"AT+QISEND=%d,%d", connectID, d->len);
 
-	bg_infoTM_t valueTM = {.statusTM = BG_TM_ACTIVE, .statusNoCarrier = BG_TM_NO_CARRIER_RESET,\
-		 .connectID = connectID};
+			else
+				err = bg_send_data_async(BG_TIMEOUT_ANSW_OK_LONG, d->data, d->len, bg_udp_batch_callback, &batch,\
+					"AT+QISEND=%d,%d,\"%s\",%d", connectID, d->len, d->ip, d->port);
 
-	bg_setter_transparentMode(valueTM);
+			//solo los datagramas encolados tienen callback, el resto no ocupa lugar en queued
+			if(err == BG_OK)
+				batch.queued[(batch.head + batch.inflight++) % BG_TX_PIPELINE_DEPTH] = next - 1;
 
-	return BG_OK_TRANSPARENT_MODE;
-}
-//-----------------------Funciones de apertura de socket end------------------------
+			else if(batch.err == BG_OK)
+				batch.err = err;
+		}
 
+		bg_poll();
 
-//-----------------------Funciones de cierre y desactivacion-------------------------
-bg_err_t bg_exit_transparent_mode(void)
-{
-	bgDelay(2000);
-	memset(uBg.buff, '\0', sizeof(uBg.buff));
-	if(bgUartTx("+++", 3))
-	{
-		LOG_BG(LE, "[BG_ERR] ERROR MCU TX UART\n");
-		return BG_ERR_MCU_TX_UART;
+		if(batch.inflight > 0)
+			bg_wait_event(bgCmdDeadline);
 	}
-	bgDelay(1000);
-	
-	CHECK_EXIT_TM_ANSW(uBg.buff, BG_TIMEOUT_ANSW_OK);
-	LOG_BG(LE, "EXIT TM CHECKED\n");
-
-	bg_infoTM_t infoTM = bg_getter_transparentMode();
-	bg_infoTM_t valueTM = {.statusTM = BG_TM_INACTIVE, .statusNoCarrier = infoTM.statusNoCarrier,\
-		.connectID = infoTM.connectID};
-	bg_setter_transparentMode(valueTM);
 
-	return BG_OK_EXIT_TRANSPARENT_MODE;
-}
+	bgScktTbl[connectID].txBytes += batch.bytes;
 
-bg_err_t bg_close_sckt(uint8_t connectID)
-{
-	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
+	LOG_BG(LD, "[BG_LOG] LOTE UDP connectID: %d datagramas: %d/%d\n", connectID, batch.sent, cnt);
 
-	bg_err_t err = bg_send(30, LE, "AT+QICLOSE=%d", connectID);
-	CHECK_BG_ERR(err);
+	if(sent != NULL)
+		*sent = batch.sent;
 
-	return BG_OK_CONNECT_ID_CLOSED;
+	return (batch.err == BG_OK) ? BG_OK_TRANSMIT : batch.err;
 }
 
-bg_err_t bg_detach(void)
+static void bg_udp_batch_callback(bg_cmdResult_t result, void *ctx)
 {
-	bg_err_t err = bg_send(90, LE, "AT+COPS=2");
-	CHECK_BG_ERR(err);
+	bg_udpBatch_t *batch = (bg_udpBatch_t *)ctx;
+	uint16_t len = batch->dgram[batch->queued[batch->head]].len;
 
-	CHECK_DESIRED_ANSW(uBg.buff, "OK", BG_TIMEOUT_ANSW_OK);
+	batch->head = (batch->head + 1) % BG_TX_PIPELINE_DEPTH;
+	batch->inflight--;
 
-	return BG_OK_DETACH;
-}
-//-----------------------Funciones de cierre y desactivacion end---------------------
+	if(result.err == BG_OK && result.final == BG_TOK_SEND_OK)
+	{
+		batch->sent++;
+		batch->bytes += len;
+		return;
+	}
 
+	if(batch->err == BG_OK)
+		batch->err = (result.err != BG_OK) ? result.err : BG_ERR_TIMEOUT_ANS_DESIRED;
+}
 
-//----------------------Funciones de transmision recepcion de mensajes---------------
-bg_err_t bg_transmit_buffAMode(uint8_t connectID, uint8_t *data, uint16_t len)
+static void bg_large_send_callback(bg_cmdResult_t result, void *ctx)
 {
-	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
-
-	if(data == NULL) return BG_ERR_MCU_PTR_NULL;
-
-	bg_err_t err = BG_OK;
-	err = bg_send(5, LE, "AT+QISEND=%d,%d", connectID, len);
-	CHECK_BG_ERR(err);
+	bg_largeSend_t *ls = (bg_largeSend_t *)ctx;
+	uint16_t seg = (ls->len - ls->done < BG_QISEND_MAX_LEN) ? ls->len - ls->done : BG_QISEND_MAX_LEN;
 
-	//espera respuesta del modulo para enviar mensaje
-	CHECK_DESIRED_ANSW(uBg.buff, ">", BG_TIMEOUT_ANSW_OK);
+	ls->inflight--;
+	ls->done += seg;
 
-	//transmite el mensaje
-	if(bgUartTx(data, len))
+	if(result.err == BG_OK && result.final == BG_TOK_SEND_OK)
 	{
-		LOG_BG(LE, "[BG_ERR] ERROR MCU TX UART\n");
-		return BG_ERR_MCU_TX_UART;
+		ls->stats.bytes += seg;
+		return;
 	}
 
-	//espera confirmacion de envio de mensaje
-	CHECK_DESIRED_ANSW(uBg.buff, "SEND OK", BG_TIMEOUT_ANSW_OK_LONG);
-
-	printf("%s\n",uBg.buff);
-	return BG_OK_TRANSMIT;
+	//un segmento que falla detiene el envio (el siguiente ya en la cola tambien se descarta del conteo)
+	if(ls->err == BG_OK)
+	{
+		ls->err = (result.err != BG_OK) ? result.err : BG_ERR_TIMEOUT_ANS_DESIRED;
+		LOG_BG(LE, "[BG_ERR] SEGMENTO DE ENVIO GRANDE FALLIDO EN EL BYTE %lu\n", ls->done - seg);
+	}
 }
 
-bg_err_t bg_receive_buffAMode(uint8_t connectID, uint8_t *buff, uint16_t *len)
+static void bg_large_query_callback(bg_cmdResult_t result, void *ctx)
 {
-	if(connectID > BG_CONNECT_ID_MAX) return BG_ERR_CONNECT_ID_UNSUPORTED;
-
-	if(buff == NULL || len == NULL) return BG_ERR_MCU_PTR_NULL;
-
-	uint8_t flgOverFlow = 0;
-
-	bg_err_t err = bg_send(15, LE, "AT+QIRD=%d,1500", connectID);
-	CHECK_BG_ERR(err);
-
-	uint8_t *parsePtr = strchr(uBg.buff, ' ');
+	bg_largeSend_t *ls = (bg_largeSend_t *)ctx;
+	uint8_t *unackedPtr = (result.err == BG_OK && result.info != NULL) ? strrchr(result.info, ',') : NULL;
 
-	uint8_t auxLen[10] = {'\0'};
+	ls->query = 0;
 
-	if(parsePtr)
+	//sin respuesta valida no se pausa, el envio sigue al ritmo de SEND OK
+	if(unackedPtr == NULL || strtoul(unackedPtr + 1, NULL, 10) <= BG_TX_UNACKED_MAX)
 	{
-		COPY_PARSE_STR(auxLen, sizeof(auxLen), parsePtr, ' ', '\n');
-		*len = atoi(auxLen);
-		
-		if(*len > 1024) 
-		{
-			*len = 1024;
-			flgOverFlow = 1;
-		}
-		
-		LOG_BG(LD,"RECVlen: %ld\n", *len);
-		parsePtr++;
+		ls->hold = 0;
+		return;
 	}
-	
-	parsePtr = strchr(parsePtr, '\n');
 
-	if(parsePtr)
-	{
-		parsePtr++;
-		memcpy(buff, parsePtr, *len);
-	}
+	ls->hold = 1;
+	ls->nextQuery = bg_get_tick_ms() + BG_TX_PACE_MS;
+	ls->stats.paceWaits++;
+}
+
+static void bg_tx_coalesce_callback(bg_cmdResult_t result, void *ctx)
+{
+	bg_txBuff_t *buff = (bg_txBuff_t *)ctx;
+	bg_txCoalesce_t *co = &bgTxCoalesce[buff->connectID];
+
+	if(result.err == BG_OK && result.final == BG_TOK_SEND_OK)
+		bgScktTbl[buff->connectID].txBytes += buff->len;
 
-	//TODO: Hacer una estrategia en caso de que se reciban mas de 1024Bytes ya que el buffer del modulo guardara el resto y se deberia limpiar
-	if(flgOverFlow)
+	else
 	{
-		bg_close_sckt(connectID);
+		co->lastErr = (result.err != BG_OK) ? result.err : BG_ERR_TIMEOUT_ANS_DESIRED;
+		co->stats.errors++;
+		LOG_BG(LE, "[BG_ERR] ENVIO AGRUPADO FALLIDO connectID: %d len: %d\n", buff->connectID, buff->len);
 	}
 
-	return BG_OK_RECEIVE;
+	buff->len = 0;
+	buff->state = BG_TX_BUFF_FREE;
 }
 
 bg_err_t bg_transmit_TM(uint8_t *data, uint16_t len)
@@ -1061,7 +4944,13 @@ bg_err_t bg_transmit_TM(uint8_t *data, uint16_t len)
 	bg_infoTM_t infoTM = bg_getter_transparentMode();
 
 	if(infoTM.statusTM == BG_TM_ACTIVE)
+	{
 		bgUartTx(data, len);
+		bgTmLastTx = bg_get_tick_ms();
+
+		if(infoTM.connectID <= BG_CONNECT_ID_MAX)
+			bgScktTbl[infoTM.connectID].txBytes += len;
+	}
 	
 	return BG_OK_TRANSMIT;
 }
@@ -1124,6 +5013,18 @@ __bg_weak__ void bg_urc_parsed_callback(urcInfoData_t infoUrc)
 			bg_pdp_activation_callback(infoUrc.contextID);
 			//activar contexto PDP
 		break;
+
+		case BG_URC_CEREG:
+			LOG_BG(LE, "PARSED URC CEREG stat: %d\n", infoUrc.result);
+		break;
+
+		case BG_URC_QIOPEN:
+			LOG_BG(LE, "PARSED URC QIOPEN connectID: %d err: %d\n", infoUrc.connectID, infoUrc.result);
+		break;
+
+		case BG_URC_CPIN:
+			LOG_BG(LE, "PARSED URC CPIN ready: %d\n", infoUrc.result);
+		break;
 	}
 }
 
@@ -1160,29 +5061,52 @@ __bg_weak__ void bg_pdp_activation_callback(uint8_t contextID)
 
 __bg_weak__ void bg_callback_TM_Inactive(uint8_t connectID, bg_noCarrierTM_t statusNoCarrier)
 {
+	//el punto remoto cerro la conexion, no tiene caso consultar el socket
 	if(statusNoCarrier == BG_TM_NO_CARRIER_SET)
+	{
 		LOG_BG(LE, "Salida por NO CARRIER\n");
+		return;
+	}
 	
-	if(bg_check_sckt(connectID) == BG_OK_CONNECT_ID_OPENNED)
+	//el estado se toma de la tabla de sockets, no se consulta AT+QISTATE
+	if(bg_get_sckt_state(connectID) == BG_SCKT_STATE_CONNECTED)
 		if(bg_transparent_mode(connectID) == BG_OK_TRANSPARENT_MODE)
 			LOG_BG(LE, "Modo TM exitoso\n");
 }
+
+__bg_weak__ void bg_bringup_callback(bg_bringupStage_t stage, bg_err_t err, uint32_t durationMs)
+{
+	uint8_t *strStage[] = {"POWER", "SIM", "PDP_CONF", "ATTACH", "PDP_ACT", "SOCKETS"};
+
+	LOG_BG(LE, "[BG_LOG] ARRANQUE %s: %d en %lu ms\n", strStage[stage], err, durationMs);
+}
 //---------------------------Callbacks LIB para MCU end------------------------
 
 
 //-------------------------------------Funciones de cola----------------------------
 void bg_queue_put(urcRawData_t urc)
 {	
-	qData_t item = {.data.urc = urc, .type = T_BG_URC};
-	bgUrcQueue.put(&bgUrcQueue, item);
+	if(urc.buff == NULL) return;
+
+	if(urc.len > SIZE_URC_BUFF) urc.len = SIZE_URC_BUFF;
+
+	if(bgUrcQueue.put(&bgUrcQueue, urc.type, urc.buff, urc.len) != 0)
+		LOG_BG(LE, "[BG_ERR] COLA DE URC LLENA, URC DESCARTADO: %d\n", urc.type);
 }
 
 void bg_queue_pop(urcRawData_t *urc)
 {
-	qData_t item = bgUrcQueue.pop(&bgUrcQueue);
+	if(!bgUrcQueue.peek(&bgUrcQueue, urc))
+	{
+		urc->buff = (uint8_t *)"";
+		urc->len = 0;
+		urc->type = BG_URC_UNSUPPORTED;
+	}
+}
 
-	if(item.type == T_BG_URC)
-		*urc = item.data.urc;
+void bg_queue_release(void)
+{
+	bgUrcQueue.release(&bgUrcQueue);
 }
 
 uint8_t bg_queue_is_empty(void)
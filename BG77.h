@@ -29,6 +29,8 @@
  * 		6.2 Registrar (attachar) seleccionando la operadora (COPS).
  * 7. Configurar y activar el contexto PDP.
  * 8. Configurar y abrir sockets (SERVIDOR o CLIENTE).
+ * 		NOTE: Los pasos 4 a 8 tambien se pueden hacer sin bloquear con el arranque de red
+ * 		bg_bringup_start() / bg_bringup_step(), que ademas mide el tiempo de cada etapa.
  * 9. Colocar funcion de manejo de URC en loop de la aplicacion principal.
  * 
  * 10. Recepcion y transmision de mensajes.
@@ -73,7 +75,8 @@
 			}
 			@endcode
  *		11.4 Callback de modo transparente inactivo. El proposito es notificar al usuario
- *			para que pueda regresar a modo transparente.
+ *			para que pueda regresar a modo transparente (solo se llama despues de una salida de TM,
+ *			con la politica de bg_set_tm_reentry()).
  			@code
 			void bg_callback_TM_Inactive(void)
 			{
@@ -105,7 +108,8 @@
 
 	bg_err_t gpioWrite(bgPin_t pin, uint8_t state)
 	{
-		if(pin >= BG_UNSUPORTED_PIN)
+		//este ejemplo no conecta MAIN_DTR (.dtrPin = 0)
+		if(pin >= BG_DTR_PIN)
 			return BG_ERR_UNSUPPORTED_PIN;
 			
 		bg_err_t err = BG_OK;
@@ -129,8 +133,14 @@
 		HAL_NVIC_SystemReset();
 	}
 
+	//waitEvent y notifyEvent son opcionales (NULL), con ellos el MCU no queda en un ciclo activo
+	//mientras espera las respuestas del modulo, ej. con FreeRTOS:
+	//void waitEvent(uint32_t maxMs) { xSemaphoreTake(semBg, pdMS_TO_TICKS(maxMs)); }
+	//void notifyEvent(void) { xSemaphoreGiveFromISR(semBg, NULL); }
+	//statusRead es opcional (NULL), permite saber si el modulo esta encendido sin esperar respuesta a "AT":
+	//uint8_t statusRead(void) { return HAL_GPIO_ReadPin(BG_STATUS_GPIO_Port, BG_STATUS_Pin); }
 	bg_bspFun_t bspFun = {.uartTx = uart_tx, .gpioWrite = gpioWrite, .msDelay = msDelay,\
-	.resetMCU = resetMCU};
+	.resetMCU = resetMCU, .waitEvent = NULL, .notifyEvent = NULL, .statusRead = NULL, .dtrPin = 0};
 	//-----------------------------BSP end--------------------------------------
 
 
@@ -189,72 +199,47 @@
 		flg_uart = 0;
 		
 
-		//-------------------------------Inicializando el modulo (libreria)-----------------------------
-		bg_init_module();
-		bg_data_module();
+		//---------------------Socket 1 SERVIDOR y socket 2 CLIENTE---------------------------
+		bgSckt_t mySckt = {.ctxtID = 1, .connectID = 0, .ip = BG_OPEN_SERVER_IP,\
+		.accssMode = BG_OPEN_BUFF_ACCSS_MODE, .serviceType = BG_OPEN_SERVER,\
+		.remotePort = BG_OPEN_SERVER_REMOTE_PORT, .localPort = 2000};
 
-		//-------------------------------Verificacion de SIM-------------------------------
-		if(bg_check_sim() == BG_OK_SIM)
-			printf("SIM OK\n");
-		else
-			printf("SIM NO OK\n");
+		bgSckt_t mySckt2 = {.ctxtID = 1, .connectID = 1, .ip = IP_METERCAD,\
+			.accssMode = BG_OPEN_BUFF_ACCSS_MODE, .serviceType = BG_OPEN_CLIENT,\
+			.remotePort = 2001, .localPort = BG_OPEN_CLIENT_LOCAL_PORT};
 
-		//--------------------Verificacion si el modulo esta registrado--------------------
-		if(bg_check_attach() == BG_OK_ATTACH)
-			printf("ATTACH OK\n");
-		else
-			printf("ATTACH NO OK\n");
+		bgSckt_t myScktList[] = {mySckt, mySckt2};
 
-		//------------------------------Verificacion de COPS--------------------------------
-		if(bg_query_cops() == BG_ERR_NO_OPER)
-			printf("No se ha seleccionado operadora\n");
+		//-------------Arranque de red: encendido, SIM, registro, contexto PDP y sockets-------------
+		//El contexto PDP se configura mientras el modulo se registra y los sockets se abren en paralelo
+		bg_bringupCfg_t netCfg = {.operator = COPS_LF, .pdp = {.ctxtID = 1, .contextType = BG_CTXT_IPV4,\
+			.apn = APN_LINKS_FIELD, .usr = "", .psw = ""}, .sckt = myScktList, .nSckt = 2};
 
-		//--------------------Consulta la configuracion del contexto PDP--------------------
-		if(bg_query_conf_pdp(1) == BG_ERR_NO_CONF_PDP)
-		printf("No se ha configurado contexto PDP\n");
+		bg_bringup_start(&netCfg);
 
-		//--------------------Se verifica si esta activado el contexto PDP------------------
-		if(bg_check_pdp(1) == BG_OK_PDP_DEACT)
-			printf("No esta activado el contexto PDP 1\n");
+		//bg_bringup_step() atiende los URC, mientras dura el arranque no se llama a bg_handle_urc()
+		while(bg_bringup_step() < BG_BRINGUP_DONE)
+		{
+			//la aplicacion puede atender otras tareas mientras el modulo se registra
+		}
 
-		//---------------------Se realiza el proceso de registro en la red------------------
-		if(bg_attach(COPS_LF) == BG_OK_ATTACH)
-			printf("Modulo ATTACHADO\n");
+		bg_bringupStats_t netStats = bg_get_bringup_stats();
 
-		//----------------------Verifica si se el modulo esta registrado-------------------
-		if(bg_check_attach() == BG_OK_ATTACH)
-			printf("ATTACH OK\n");
+		if(netStats.stage == BG_BRINGUP_DONE)
+			printf("Red lista en %lu ms (registro: %lu ms)\n", netStats.readyMs, netStats.durationMs[BG_BRINGUP_ATTACH]);
 		else
-			printf("ATTACH NO OK\n");
-
-		//-----------------------------Configura conterxto PDP-----------------------------
-		bg_ctxPdp_t contextPDP_1 ={.ctxtID = 1, .contextType = BG_CTXT_IPV4,\
-			.apn = APN_LINKS_FIELD, .usr = "", .psw = ""};
-		bg_conf_pdp(contextPDP_1);
+			printf("Fallo el arranque de red en la etapa %d: %d\n", netStats.failStage, netStats.err);
 
-		//-------------------------------Activa contexto PDP------------------------------
-		bg_pdp_activation(1, BG_PDP_ACT);
+		bg_data_module();
 
 		//------------------------------Verificacion de COPS--------------------------------
 		if(bg_query_cops() == BG_ERR_NO_OPER)
 			printf("No se ha seleccionado operadora\n");
 
-		//---------------------Creacion y apertura de socket 1 SERVIDOR----------------------
-		bgSckt_t mySckt = {.ctxtID = 1, .connectID = 0, .ip = BG_OPEN_SERVER_IP,\
-		.accssMode = BG_OPEN_BUFF_ACCSS_MODE, .serviceType = BG_OPEN_SERVER,\
-		.remotePort = BG_OPEN_SERVER_REMOTE_PORT, .localPort = 2000};
-		
-		bg_open_sckt(mySckt);
-		//---------------------Creacion y apertura de socket 1 SERVIDOR end--------------------
-
-		//----------------------Creacion y apertura de socket 2 CLIENTE------------------------
-		bgSckt_t mySckt2 = {.ctxtID = 1, .connectID = 1, .ip = IP_METERCAD,\
-			.accssMode = BG_OPEN_BUFF_ACCSS_MODE, .serviceType = BG_OPEN_CLIENT,\
-			.remotePort = 2001, .localPort = BG_OPEN_CLIENT_LOCAL_PORT};
-
-		if(bg_open_sckt(mySckt2) == BG_OK_CONNECT_ID_OPENNED)
-			printf("Conexion myScket2 Abierta\n");
-		//----------------------Creacion y apertura de socket 2 CLIENTE end---------------------
+		//--------------------Se verifica si esta activado el contexto PDP------------------
+		if(bg_check_pdp(1) == BG_OK_PDP_DEACT)
+			printf("No esta activado el contexto PDP 1\n");
+		//-------------Arranque de red: encendido, SIM, registro, contexto PDP y sockets end---------
 
 		//--------------Transmision de mensajes de socket 2 en Buffer access mode---------------
 		if(bg_transmit_buffAMode(mySckt2.connectID, "hello DOGO \x00\xFF", 13) == BG_OK_TRANSMIT)
@@ -268,8 +253,9 @@
 		if(bg_transparent_mode(mySckt2.connectID) == BG_OK_TRANSPARENT_MODE)
 		{
 			printf("Modo transparente exitoso\n");
-			HAL_UART_Transmit(&UART_BG, "hello server", 12, 1000);
-			//bg_transmit_TM("hello server", 12); //o tambien se puede usar esta funcion
+			bg_transmit_TM("hello server", 12);
+			//HAL_UART_Transmit(&UART_BG, "hello server", 12, 1000); //tambien funciona, pero la libreria no registra
+			//el instante del ultimo byte y la salida de TM espera el tiempo de guarda completo
 		}
 
 		//-------------------Salida de modo transparente y cierre del socket 2------------------
@@ -279,7 +265,7 @@
 				bg_check_pdp(1);
 				bg_close_sckt(mySckt2.connectID);
 			
-				if(bg_check_sckt(mySckt2.connectID) == BG_OK_CONNECT_ID_CLOSED)
+				if(bg_get_sckt_state(mySckt2.connectID) == BG_SCKT_STATE_INITIAL)
 					printf("Socket cerrado\n");
 		}
 
@@ -363,6 +349,7 @@
 #include "stdlib.h"
 #include "string.h"
 #include "stdarg.h"
+#include "ctype.h"
 
 #include "../BG77/queue_module/queue_module.h"
 
@@ -408,11 +395,35 @@ do{\
  */
 #define __bg_weak__ __attribute__((weak))
 
-#define MAX_SEC 0XFFFFFFFFUL
-
-#define BG_TIMEOUT_ANSW 10UL 			//timeout de espera de respuesta de comando BG
-#define BG_TIMEOUT_ANSW_OK 20UL 		//timeout de espera de respuesta esperada del modulo BG
-#define BG_TIMEOUT_ANSW_OK_LONG 40UL 	//timeout de espera de respuesta esperada del modulo BG para tiempos largos
+/**
+ * @brief MACRO que indica si ya se alcanzo (o se paso) el instante limite deadline en ms, es valida aun
+ * cuando el contador de ms se desborda (compara la diferencia con signo).
+ * 
+ */
+#define BG_DEADLINE_REACHED(now, deadline) ((int32_t)((uint32_t)(now) - (uint32_t)(deadline)) >= 0)
+
+#define BG_TIMEOUT_QUICK 300UL 			//timeout (ms) de comandos de respuesta inmediata (300ms en el manual AT)
+#define BG_TIMEOUT_ANSW 10000UL 		//timeout (ms) de espera de respuesta de comando BG
+#define BG_TIMEOUT_ANSW_OK 20000UL 		//timeout (ms) de espera de respuesta esperada del modulo BG
+#define BG_TIMEOUT_ANSW_OK_LONG 40000UL //timeout (ms) de espera de respuesta esperada del modulo BG para tiempos largos
+#define BG_WAIT_EVENT_MAX_MS 100UL		//tiempo maximo (ms) que se bloquea el hook waitEvent antes de revisar de nuevo el timeout
+#define BG_PWRKEY_PULSE_MS 700UL		//duracion (ms) del pulso de PWRKEY para encender (minimo 500ms segun hardware design BG77)
+#define BG_RESET_PULSE_MS 300UL			//duracion (ms) del pulso de RESET_N para reiniciar un modulo que no contesta
+#define BG_BOOT_TIMEOUT 10000UL			//timeout (ms) de espera de RDY/APP RDY (o pin STATUS) despues del pulso de encendido
+#define BG_BOOT_PROBE_TRIES 3			//numero de intentos de "AT" para detectar si el modulo ya esta encendido
+#define BG_POWER_ON_ATTEMPTS 3			//intentos de encendido de bg_init_module antes de reiniciar el MCU
+#define BG_TM_GUARD_MS 1000UL			//tiempo de guarda (ms) sin enviar datos antes y despues de "+++" (manual TCP/IP AT)
+#define BG_DTR_PULSE_MS 50UL			//duracion (ms) del flanco ON->OFF de MAIN_DTR para salir de modo transparente (AT&D1)
+#define BG_TM_WAIT_TIME 2				//AT+QICFG="transwaittm" por defecto (x100ms sin datos por UART para enviar lo acumulado en TM)
+#define BG_TM_WAIT_TIME_MAX 20			//valor maximo de AT+QICFG="transwaittm" (2s)
+#define BG_TM_REENTRY_DELAY_MS 500UL		//tiempo (ms) sin URC despues de salir de TM antes de regresar (histeresis)
+#define BG_TM_REENTRY_MAX_DELAY_MS 30000UL	//espera maxima (ms) entre intentos de regreso a TM (se duplica en cada fallo)
+#define BG_TM_REENTRY_MAX_TRIES 5			//intentos de regreso a TM despues de una salida
+#define BG_BRINGUP_SIM_TIMEOUT 20000UL		//timeout (ms) de la etapa SIM del arranque de red (+CPIN: READY)
+#define BG_BRINGUP_ATTACH_TIMEOUT 180000UL	//timeout (ms) del registro en red del arranque (mismo tiempo que AT+COPS en bg_attach)
+#define BG_BRINGUP_PDP_TIMEOUT 150000UL		//timeout (ms) de activacion del contexto PDP (tiempo maximo de AT+QIACT)
+#define BG_BRINGUP_SCKT_TIMEOUT 150000UL	//timeout (ms) de apertura de sockets del arranque (tiempo maximo de +QIOPEN)
+#define BG_BRINGUP_POLL_MS 2000UL			//periodo (ms) de consultas de respaldo (AT+CPIN?, AT+CEREG?) mientras no llega el URC
 
 #define IP_METERCAD  "192.168.4.58"		//Direccion IP de maquina virtual metercad
 #define IP_PROXYGAMMA "192.168.4.57" 	//Direccion IP de maquina virtual proxygamma
@@ -504,19 +515,55 @@ do { \
 } while(0)
 
 /**
- * @brief Verifica que una cadena deseada se encuentre dentro de un array o buffer durante un tiempo especificado. 
+ * @brief Obtiene la mascara de bit de un token del tipo bg_token_t.
  * 
- * @param srcBuff Es el buffer o array en donde se va a buscar la cadena deseada.
- * @param desiredAnsw Es la cadena deseada que se quiere buscar dentro del array.
- * @param _timeot Es el tiempo de espera en el que tratara de encontrar la cadena deseada.
+ */
+#define BG_TOKEN_MASK(tok) (1UL << (tok))
+
+/**
+ * @brief Mascara de los tokens que terminan la espera de respuesta de un comando AT
+ * (codigos de resultado final y el prompt '>').
+ * 
+ */
+#define BG_TOKEN_FINAL_MASK (BG_TOKEN_MASK(BG_TOK_OK) | BG_TOKEN_MASK(BG_TOK_ERROR) | BG_TOKEN_MASK(BG_TOK_PROMPT) |\
+	BG_TOKEN_MASK(BG_TOK_CONNECT) | BG_TOKEN_MASK(BG_TOK_NO_CARRIER) | BG_TOKEN_MASK(BG_TOK_SEND_OK) |\
+	BG_TOKEN_MASK(BG_TOK_SEND_FAIL) | BG_TOKEN_MASK(BG_TOK_CME_ERROR) | BG_TOKEN_MASK(BG_TOK_CMS_ERROR))
+
+/**
+ * @brief Mascara de los codigos de resultado final que indican que el comando fallo.
+ * 
+ */
+#define BG_TOKEN_FAIL_MASK (BG_TOKEN_MASK(BG_TOK_ERROR) | BG_TOKEN_MASK(BG_TOK_SEND_FAIL) |\
+	BG_TOKEN_MASK(BG_TOK_CME_ERROR) | BG_TOKEN_MASK(BG_TOK_CMS_ERROR))
+
+/**
+ * @brief Indica si un codigo de error es una respuesta de error del modulo a un comando AT
+ * (ERROR, +CME ERROR o +CMS ERROR), es decir, el modulo si contesto.
  * 
  */
-#define CHECK_DESIRED_ANSW(srcBuff, desiredAnsw, _timeout)\
+#define BG_IS_AT_ERR(err) ((err) == BG_ERR_AT || (err) == BG_ERR_CME || (err) == BG_ERR_CMS)
+/**
+ * @brief Verifica que el tokenizador de respuestas genere alguno de los tokens deseados durante un tiempo especificado. 
+ * Solo se analizan los bytes nuevos que van llegando, no se vuelve a recorrer el buffer de respuesta.
+ * Si antes llega un codigo de resultado de error (BG_TOKEN_FAIL_MASK) que no es deseado, regresa de inmediato
+ * con el error correspondiente (BG_ERR_AT, BG_ERR_CME, BG_ERR_CMS o BG_ERR_SEND_FAIL).
+ * 
+ * @param desiredTokens Es la mascara de tokens deseados (ej. BG_TOKEN_MASK(BG_TOK_SEND_OK)).
+ * @param _timeot Es el tiempo de espera (ms) en el que tratara de encontrar alguno de los tokens deseados.
+ * 
+ */
+#define CHECK_DESIRED_ANSW(desiredTokens, _timeout)\
 do{\
-	bg_start_timeout();\
-	while(!strstr(srcBuff, desiredAnsw) && count_sec_bg < _timeout)\
-		__asm__("nop");\
-	if(_timeout <= bg_stop_timeout())\
+	uint32_t _deadline = bg_get_tick_ms() + (_timeout);\
+	while((bg_rx_process(), !(bgRxTokens & ((desiredTokens) | BG_TOKEN_FAIL_MASK))) &&\
+		!BG_DEADLINE_REACHED(bg_get_tick_ms(), _deadline))\
+		bg_wait_event(_deadline);\
+	if(!(bgRxTokens & (desiredTokens)) && (bgRxTokens & BG_TOKEN_FAIL_MASK))\
+	{\
+		LOG_BG(LE,"[BG_ERR] RESULTADO DE ERROR EN LUGAR DE RESPUESTA DESEADA\n");\
+		return bg_final_err(bgRxTokens);\
+	}\
+	if(!(bgRxTokens & (desiredTokens)))\
 	{\
 		LOG_BG(LE,"[BG_ERR] TIMEOUT RESPUESTA DESEADA\n");\
 		return BG_ERR_TIMEOUT_ANS_DESIRED;\
@@ -526,60 +573,31 @@ do{\
 /**
  * @brief Verifica que el comando de Power down sea exitoso. 
  * 
- * @param srcBuff Es el buffer o array en donde esta la respuesta al comando de power down.
- * @param _timeot Es el tiempo de espera en el que tratara de verificar el comando power down.
+ * @param _timeot Es el tiempo de espera (ms) en el que tratara de verificar el comando power down.
  * 
  */
-#define CHECK_POWDWN_ANSW(srcBuff, _timeout)\
-do{\
-	bg_start_timeout();\
-	while(!strstr(srcBuff, "OK") && !strstr(srcBuff, "RDY") && count_sec_bg < _timeout)\
-		__asm__("nop");\
-	if(_timeout <= bg_stop_timeout())\
-	{\
-		LOG_BG(LE,"[BG_ERR] TIMEOUT RESPUESTA DESEADA\n");\
-		return BG_ERR_TIMEOUT_ANS_DESIRED;\
-	}\
-}while(0)
+#define CHECK_POWDWN_ANSW(_timeout)\
+	CHECK_DESIRED_ANSW(BG_TOKEN_MASK(BG_TOK_OK) | BG_TOKEN_MASK(BG_TOK_RDY) | BG_TOKEN_MASK(BG_TOK_POWERED_DOWN), _timeout)
 
 /**
  * @brief Verifica que la salida de modo transparente sea exitosa. 
  * 
- * @param srcBuff Es el buffer o array en donde esta la respuesta a la salida de modo transparente.
- * @param _timeot Es el tiempo de espera en el que tratara de verificar la salida de modo transparente.
+ * @param _timeot Es el tiempo de espera (ms) en el que tratara de verificar la salida de modo transparente.
  * 
  */
-#define CHECK_EXIT_TM_ANSW(srcBuff, _timeout)\
-do{\
-	bg_start_timeout();\
-	while(!strstr(srcBuff, "OK") && !strstr(srcBuff, "QIURC") && count_sec_bg < _timeout)\
-		__asm__("nop");\
-	if(_timeout <= bg_stop_timeout())\
-	{\
-		LOG_BG(LE,"[BG_ERR] TIMEOUT RESPUESTA DESEADA\n");\
-		return BG_ERR_TIMEOUT_ANS_DESIRED;\
-	}\
-}while(0)
+#define CHECK_EXIT_TM_ANSW(_timeout)\
+	CHECK_DESIRED_ANSW(BG_TOKEN_MASK(BG_TOK_OK) | BG_TOKEN_MASK(BG_TOK_URC), _timeout)
 
 
 /**
- * @brief Verifica que la salida de modo transparente sea exitosa.
+ * @brief Verifica que llegue la linea de resultado de apertura de socket (+QIOPEN: <connectID>,<err>).
  *
- * @param srcBuff Es el buffer o array en donde esta la respuesta a la salida de modo transparente.
- * @param _timeot Es el tiempo de espera en el que tratara de verificar la salida de modo transparente.
+ * @note El prefijo de la linea esperada se debe establecer con bg_rx_expect() antes de enviar el comando.
+ * @param _timeot Es el tiempo de espera (ms) en el que tratara de verificar la apertura del socket.
  *
  */
-#define CHECK_OPEN_SCKT(srcBuff, desiredAnsw, _timeout)\
-do{\
-	bg_start_timeout();\
-	while(!strstr(srcBuff, desiredAnsw) && !strstr(srcBuff, ",0") && count_sec_bg < _timeout)\
-		__asm__("nop");\
-	if(_timeout <= bg_stop_timeout())\
-	{\
-		LOG_BG(LE,"[BG_ERR] TIMEOUT RESPUESTA DESEADA\n");\
-		return BG_ERR_TIMEOUT_ANS_DESIRED;\
-	}\
-}while(0)
+#define CHECK_OPEN_SCKT(_timeout)\
+	CHECK_DESIRED_ANSW(BG_TOKEN_MASK(BG_TOK_EXPECTED) | BG_TOKEN_MASK(BG_TOK_ERROR), _timeout)
 
 /**
  * @brief MACRO generadora de tipos de buffer.
@@ -611,8 +629,26 @@ typedef struct \
 } name##_t;
 
 #define SIZE_BG_BUFF 2048
-/**
- * @brief Se crea un tipo de variable llamado uartBuff_t para generar buffers de uart de tamaño 1024By
+#define SIZE_BG_RING_BUFF 2048 //Tamaño del buffer circular de recepcion de UART (debe ser potencia de 2)
+#define SIZE_BG_URC_ARENA 1024 //Tamaño en bytes del arreglo donde se guardan los URC encolados (cada URC ocupa su longitud + 4 bytes)
+#define SIZE_BG_PUSH_BUFF 1500 //Maximo de bytes de un "+QIURC: \"recv\",<connectID>,<len>" en direct push mode (el resto se descarta)
+#define SIZE_BG_PUSH_ARENA 3072 //Tamaño en bytes del arreglo donde se encolan los datos de direct push mode (cada bloque ocupa su longitud + 4 bytes)
+#define BG_CMD_QUEUE_LEN 4 //Numero maximo de comandos AT en espera en el motor de comandos (bg_send_async)
+#define BG_CMD_MAX_LEN 256 //Tamaño maximo de un comando AT ya formateado (incluye "\r\n")
+#define BG_CFG_MAX_ITEMS 16 //Numero maximo de parametros de un perfil de configuracion (bg_apply_config)
+#define BG_CFG_RESP_LEN 64 //Tamaño del buffer de lectura de cada parametro del perfil de configuracion
+#define BG_QISEND_MAX_LEN 1460 //Numero maximo de bytes de un AT+QISEND en TCP
+#define BG_TX_POOL_LEN 2 //Numero de buffers de envio agrupado compartidos por todos los sockets (cada uno de BG_QISEND_MAX_LEN)
+#define BG_TX_PIPELINE_DEPTH 2 //AT+QISEND en cola durante un envio grande (menor que BG_CMD_QUEUE_LEN para dejar lugar a la consulta)
+#define BG_TX_UNACKED_MAX 8192UL //Bytes sin ACK del punto remoto a partir de los cuales se pausa un envio grande
+#define BG_QIRD_UDP_LEN 1500 //Bytes pedidos por cada AT+QIRD en sockets UDP (un datagrama completo, no mayor que la mitad de SIZE_BG_BUFF)
+#define BG_QIRD_CHUNK_LEN 1024 //Bytes pedidos por cada AT+QIRD (no mayor que urcInfoData_t.buff ni que la mitad de SIZE_BG_BUFF)
+#define BG_POOL_IDLE_MS 60000UL //Tiempo (ms) que un socket del pool puede estar sin usarse antes de cerrarse
+#define BG_POOL_CLOSE_RETRY_MS 5000UL //Espera (ms) antes de reintentar el AT+QICLOSE fallido de un socket del pool
+#define BG_OPEN_TIMEOUT 30000UL //Tiempo maximo (ms) de AT+QIOPEN: respuesta del comando y espera del resultado +QIOPEN
+#define BG_TX_PACE_MS 200UL //Periodo (ms) de consulta con AT+QISEND=<connectID>,0 mientras el envio grande esta en pausa
+/**
+ * @brief Se crea un tipo de variable llamado uartBuff_t para generar buffers de uart de tamaño 2048By
  * 
  */
 CREATE_BUFF(SIZE_BG_BUFF, uartBuff);
@@ -625,7 +661,7 @@ typedef enum{
 	BG_ERR_TIMEOUT_ANS_DESIRED, 		//Error de timeout al no recibir respuesta esperada del modulo BG
 	BG_ERR_MCU_TX_UART,			//Ocurrio un error en la transmision por UART al BG
 	BG_ERR_MCU_PTR_NULL,	//El puntero que se esta entregando apunta a NULL
-	BG_ERR_UNSUPPORTED_PIN, //Se quiere cambiar el estado de un pin no soportado o mapeado (PWR_KEY, VBAT, RESET, PON_TRIG)
+	BG_ERR_UNSUPPORTED_PIN, //Se quiere cambiar el estado de un pin no soportado o mapeado (PWR_KEY, VBAT, RESET, PON_TRIG, DTR)
 	BG_ERR_SIM_NO_OK,			//No se detecta SIM
 	BG_ERR_PARSE,			//No se encontro el delimitador con  funcion strchr()
 	BG_ERR_ATTACH_NO_OK,			//El modulo NO esta registrado en la red
@@ -637,6 +673,17 @@ typedef enum{
 	BG_ERR_CONF_PDP,	//Error en la configuracion de contexto PDP 
 	BG_ERR_ACT_PDP, 	//Error en la activacion PDP
 	BG_ERR_SIGNAL,		//No se tiene una intensidad de señal aceptable
+	BG_ERR_OPEN_SCKT,	//No se consiguio abrir la conexion (+QIOPEN: <connectID>,<err> con err distinto de 0)
+	BG_ERR_CMD_QUEUE_FULL,	//La cola de comandos AT del motor asincrono esta llena
+	BG_ERR_CMD_FORMAT,	//El comando AT no se pudo formatear o excede BG_CMD_MAX_LEN
+	BG_ERR_AT,			//El modulo respondio "ERROR"
+	BG_ERR_CME,			//El modulo respondio "+CME ERROR: <err>" (el codigo se obtiene con bg_get_cme_error())
+	BG_ERR_CMS,			//El modulo respondio "+CMS ERROR: <err>" (el codigo se obtiene con bg_get_cme_error())
+	BG_ERR_SEND_FAIL,	//El modulo respondio "SEND FAIL" al transmitir un mensaje
+	BG_ERR_CFG_PROFILE,	//El perfil de configuracion tiene mas de BG_CFG_MAX_ITEMS parametros
+	BG_ERR_TM_WAIT_TIME,	//El tiempo de espera de modo transparente esta fuera de rango (0-BG_TM_WAIT_TIME_MAX)
+	BG_ERR_TX_POOL_FULL,	//No hay buffer libre de envio agrupado y ninguno se esta enviando (ej. en modo transparente)
+	BG_ERR_SEND_LEN,	//El mensaje excede BG_QISEND_MAX_LEN bytes (maximo de un AT+QISEND)
 	BG_OK = 0,				//No hay error
 	BG_OK_SIM,				//Se detecto SIM
 	BG_OK_ATTACH,			//El modulo esta registrado en la red
@@ -653,6 +700,29 @@ typedef enum{
 	BG_OK_SIGNAL	//Se tiene una intensidad de señal aceptable (rsrp >= -115 && sinr >= 0)
 }bg_err_t;
 
+/**
+ * @brief Tipo de variable que identifica los tokens que genera el tokenizador de respuestas del modulo.
+ * Cada linea completa recibida (o el prompt '>') genera un token.
+ */
+typedef enum
+{
+	BG_TOK_OK,			//Codigo de resultado final "OK"
+	BG_TOK_ERROR,		//Codigo de resultado final "ERROR"
+	BG_TOK_PROMPT,		//Prompt '>' para enviar datos
+	BG_TOK_CONNECT,		//"CONNECT" (entrada a modo transparente)
+	BG_TOK_NO_CARRIER,	//"NO CARRIER" (desconexion en modo transparente)
+	BG_TOK_SEND_OK,		//"SEND OK"
+	BG_TOK_SEND_FAIL,	//"SEND FAIL"
+	BG_TOK_CME_ERROR,	//Codigo de resultado final "+CME ERROR: <err>"
+	BG_TOK_CMS_ERROR,	//Codigo de resultado final "+CMS ERROR: <err>"
+	BG_TOK_RDY,			//"RDY" o "APP RDY" (modulo listo despues de encender)
+	BG_TOK_POWERED_DOWN,	//"POWERED DOWN"
+	BG_TOK_URC,			//Linea reconocida como URC
+	BG_TOK_EXPECTED,	//Linea que inicia con el prefijo esperado
+	BG_TOK_LINE,		//Respuesta intermedia
+	BG_TOK_UNSUPPORTED
+}bg_token_t;
+
 //-----------------------------------Flags-----------------------------------
 /**
  * @brief Tipo de dato para crear variables de banderas de 1 bit (16 bits)
@@ -689,6 +759,7 @@ typedef enum
 	BG_VBAT_PIN,
 	BG_RESET_PIN,
 	BG_PON_TRIG_PIN,
+	BG_DTR_PIN,			//MAIN_DTR, 1: DTR activo (ON), solo se usa si bg_bspFun_t.dtrPin = 1
 	BG_UNSUPORTED_PIN
 }bgPin_t;
 
@@ -698,6 +769,24 @@ typedef enum
  */
 typedef bg_err_t (*uartFun_t)(uint8_t *data, uint16_t len);
 
+/**
+ * @brief Tipo de variable que describe un segmento de un mensaje formado por varios buffers (ej. encabezado,
+ * cuerpo y CRC), se usa en bg_transmit_buffAMode_iov() y en la transmision vectorizada del BSP.
+ * 
+ */
+typedef struct
+{
+	const uint8_t *base;	//Inicio del segmento
+	uint16_t len;			//Numero de bytes del segmento
+}bg_iovec_t;
+
+/**
+ * @brief tipo de dato para crear un puntero a funcion de transmision por UART de varios segmentos seguidos
+ * (ej. una cadena de descriptores de DMA).
+ * 
+ */
+typedef bg_err_t (*uartTxvFun_t)(const bg_iovec_t *iov, uint8_t iovCnt);
+
 /**
  * @brief tipo de dato para crear un puntero a funcion de escritura de GPIOs
  * 
@@ -716,9 +805,37 @@ typedef void (*delayFun_t)(uint32_t mDelay);
  */
 typedef void (*resetFun_t)(void);
 
+/**
+ * @brief tipo de dato para crear un puntero a funcion que bloquea hasta que llegue un evento de recepcion
+ * o pasen maxMs milisegundos (ej. tomar un semaforo en RTOS, WFI en bare metal, pthread_cond_timedwait en Linux).
+ * 
+ * NOTE: Un evento notificado antes de entrar a la espera no se debe perder (semaforo binario) o la espera
+ * debe despertar con la interrupcion de 1ms (WFI).
+ */
+typedef void (*waitEventFun_t)(uint32_t maxMs);
+
+/**
+ * @brief tipo de dato para crear un puntero a funcion que despierta a waitEventFun_t.
+ * 
+ * NOTE: Se llama desde bg_uartCallback() y bg_mainRICallback(), es decir, desde la interrupcion
+ * (ej. xSemaphoreGiveFromISR en RTOS).
+ */
+typedef void (*notifyEventFun_t)(void);
+
+/**
+ * @brief tipo de dato para crear un puntero a funcion que lee el pin STATUS del modulo.
+ * Debe regresar 1 si el modulo esta encendido y 0 si esta apagado.
+ */
+typedef uint8_t (*statusReadFun_t)(void);
+
 /**
  * @brief Tipo de variable que contiene los punteros a funcion del BSP
  * 
+ * NOTE: waitEvent y notifyEvent son opcionales, si waitEvent es NULL la libreria espera las respuestas
+ * en un ciclo activo (nop). statusRead tambien es opcional, sin el pin STATUS el encendido se detecta
+ * solo con "AT" y el URC RDY/APP RDY. Con dtrPin = 1 la salida de modo transparente se hace con MAIN_DTR
+ * (AT&D1) en lugar de "+++". uartTxv es opcional, sin el los segmentos de bg_transmit_buffAMode_iov() se
+ * envian uno tras otro con uartTx.
  */
 typedef struct
 {
@@ -726,10 +843,16 @@ typedef struct
 	gpioWriteFun_t gpioWrite;
 	delayFun_t msDelay;
 	resetFun_t resetMCU;
+	waitEventFun_t waitEvent;
+	notifyEventFun_t notifyEvent;
+	statusReadFun_t statusRead;
+	uint8_t dtrPin;		//1: gpioWrite controla BG_DTR_PIN, 0: no se tiene conectado MAIN_DTR
+	uartTxvFun_t uartTxv;
 }bg_bspFun_t;
 
 /**
- * @brief Funcion para establecer los punteros a función del BSP (UART TX, Delay, GPIO_write, Reset de MCU).
+ * @brief Funcion para establecer los punteros a función del BSP (UART TX, Delay, GPIO_write, Reset de MCU
+ * y opcionalmente los hooks de espera/notificacion de eventos de recepcion).
  * 
  * @param bspFun Variable que contiene los punteros a funcion para el BSP.
  */
@@ -760,6 +883,7 @@ typedef struct{
 	uint8_t connectID;
 	uint8_t contextID;
 	uint8_t serverID;
+	uint16_t result; //Codigo de estado/resultado del URC (<stat> de +CEREG, <err> de +QIOPEN, 1 si +CPIN: READY)
 }urcInfoData_t;
 
 /**
@@ -771,12 +895,21 @@ typedef struct{
  */
 void bg_callback_ms(void);
 
+/**
+ * @brief Devuelve el contador de ms de la libreria (monotono, se desborda cada ~49 dias).
+ * 
+ * NOTE: Para comparar instantes se debe usar BG_DEADLINE_REACHED(now, deadline) y no una comparacion directa.
+ * @return uint32_t Milisegundos contados por bg_callback_ms().
+ */
+uint32_t bg_get_tick_ms(void);
+
 /**
  * @brief Esta funcion de callback se debe llamar en una funcion de interrupcion de recepcion de uart
  * en la cual se debe pasar el buffer y el tamaño del mensaje recibido por UART.
  * 
  * Su funcion es proveer a la libreria todos los datos de recepcion por interrupcion de UART en el puerto
- * correspondiente al modulo.
+ * correspondiente al modulo. Los datos se copian una sola vez a un buffer circular interno (no se modifica buff)
+ * y se analizan despues fuera de la interrupcion, en los ciclos de espera de la libreria y en bg_handle_urc(void).
  * 
  * @param buff Es la direccion del buffer que contiene los datos recibidos en la interrupcion de UART.
  * @param nBytes Es el numero de bytes recibidos en la interrupcion de UART.
@@ -800,6 +933,9 @@ void bg_mainRICallback(mainRiEdge_t edge);
  * Si hay un URC encolado, se procede a parsearlo y a llamar a un callback para entregar informacion parseada al usuario.
  * Por defecto llama a la bg_urc_parsed_callback(urcInfoData_t infoUrc) para indicar el resultado de URC;
  * 
+ * Tambien consume los bytes pendientes del buffer circular de recepcion, por lo que los datos de modo transparente
+ * se entregan en bg_callback_receive_TM(uint8_t *buff, uint16_t nBytes) desde esta funcion.
+ * 
  * NOTE: El usuario puede presendir de esta funcion y hacer su propia estrategia de parseo de URC. Sin embargo, si se
  * quiere utilizar esta funcion, esta se debe de colocar en un ciclo de poleo en el codigo principal de la aplicacion, asi como,
  * usar las funciones bg_callback_urcDetected(urcRawData_t urcData) y bg_urc_parsed_callback(urcInfoData_t infoUrc) que tiene por defecto
@@ -813,18 +949,131 @@ void bg_handle_urc(void);
 /**
  * @brief Esta funcion permite enviar comandos AT en formato de especificadores de formato (como printf)
  * 
- * @param timeout Es el tiempo de espera para conseguir respuesta del modulo. La unidad de tiempo son segundos. 
+ * @param timeout Es el tiempo de espera para conseguir respuesta del modulo. La unidad de tiempo son milisegundos
+ * (ej. BG_TIMEOUT_QUICK para comandos de respuesta inmediata). 
  * @param enablePrint Si tiene el valor de 0 no imprime la respuesta del modulo en el Log. Cualquier otro valor, imprime la respuesta.
  * Es recomendable usar las MACROS LE (para imprimir respuesta) y LD (para NO imprimir la respuesta).
  * @param fmt Es el formato del mensaje.
  * @param ... Son los parametros variables que se utilizan en el formato del mensaje generado.
- * @return bg_err_t Retorna el codigo de error basado en el tipo bg_err_t. Si todo esta bien se espera BG_OK
+ * @return bg_err_t Retorna el codigo de error basado en el tipo bg_err_t. Si todo esta bien se espera BG_OK.
+ * Si el modulo responde ERROR, +CME ERROR o +CMS ERROR regresa en cuanto llega con BG_ERR_AT, BG_ERR_CME o BG_ERR_CMS.
  */
 bg_err_t bg_send(uint32_t timeout, uint8_t enablePrint, const char *fmt, ...);
 
 /**
- * @brief Esta funcion realiza la secuencia necesaria de los pines BG_PWRKEY_PIN, BG_VBAT_PIN,
-	BG_RESET_PIN para encender al modulo de comunicación.
+ * @brief Devuelve el codigo <err> del ultimo "+CME ERROR: <err>" o "+CMS ERROR: <err>" que respondio el modulo
+ * (se configura el formato numerico con AT+CMEE=1).
+ * 
+ * @return uint16_t Codigo de error del ultimo comando o 0 si el ultimo comando no respondio con +CME/+CMS ERROR.
+ */
+uint16_t bg_get_cme_error(void);
+
+/**
+ * @brief Tipo de variable con el resultado de un comando AT del motor asincrono que se entrega en el callback.
+ * 
+ * NOTE: resp e info apuntan al buffer de respuesta de la libreria y solo son validos durante el callback.
+ */
+typedef struct
+{
+	bg_err_t err;		//BG_OK, error decodificado del resultado final (BG_ERR_AT, BG_ERR_CME...), BG_ERR_TIMEOUT_ANS o BG_ERR_MCU_TX_UART
+	uint16_t errCode;	//Codigo <err> de "+CME ERROR" o "+CMS ERROR" (0 si no aplica)
+	bg_token_t final;	//Codigo de resultado final (BG_TOK_OK, BG_TOK_ERROR, BG_TOK_SEND_OK...), BG_TOK_UNSUPPORTED si no llego
+	uint32_t tokens;	//Mascara de todos los tokens generados durante el comando (ej. BG_TOKEN_MASK(BG_TOK_EXPECTED))
+	uint8_t *resp;		//Respuesta completa del modulo (terminada en nulo)
+	uint16_t len;		//Numero de bytes de resp
+	uint8_t *info;		//Primera linea de informacion "+<nombre>: ..." de la respuesta, NULL si no hay
+}bg_cmdResult_t;
+
+/**
+ * @brief Tipo de dato para crear un puntero a funcion de callback de fin de comando AT asincrono.
+ * 
+ * @param result Es el resultado del comando.
+ * @param ctx Es el puntero de contexto que se entrego en bg_send_async() o bg_send_data_async().
+ */
+typedef void (*bg_cmdCallback_t)(bg_cmdResult_t result, void *ctx);
+
+/**
+ * @brief Encola un comando AT en el motor asincrono y regresa sin esperar la respuesta. El comando se
+ * envia cuando le toque su turno desde bg_poll() y al terminar se llama a callback.
+ * 
+ * @param timeout Es el tiempo de espera (ms) de la respuesta, se cuenta desde que se envia el comando.
+ * @param callback Es la funcion que recibe el resultado (puede ser NULL).
+ * @param ctx Es un puntero de contexto que se entrega sin cambios al callback.
+ * @param fmt Es el formato del mensaje.
+ * @param ... Son los parametros variables que se utilizan en el formato del mensaje generado.
+ * @return bg_err_t BG_OK si se encolo, BG_ERR_CMD_QUEUE_FULL o BG_ERR_CMD_FORMAT en caso contrario.
+ */
+bg_err_t bg_send_async(uint32_t timeout, bg_cmdCallback_t callback, void *ctx, const char *fmt, ...);
+
+/**
+ * @brief Igual que bg_send_async() pero al recibir el prompt '>' transmite data y el comando termina
+ * con SEND OK, SEND FAIL o ERROR (ej. AT+QISEND=<connectID>,<len>).
+ * 
+ * NOTE: data no se copia, debe seguir siendo valido hasta que se llame a callback.
+ * @param timeout Es el tiempo de espera (ms) de cada fase (prompt y confirmacion de envio).
+ * @param data Son los bytes a transmitir despues del prompt.
+ * @param len Es el numero de bytes de data.
+ * @param callback Es la funcion que recibe el resultado (puede ser NULL).
+ * @param ctx Es un puntero de contexto que se entrega sin cambios al callback.
+ * @param fmt Es el formato del mensaje.
+ * @param ... Son los parametros variables que se utilizan en el formato del mensaje generado.
+ * @return bg_err_t BG_OK si se encolo, BG_ERR_CMD_QUEUE_FULL, BG_ERR_CMD_FORMAT o BG_ERR_MCU_PTR_NULL en caso contrario.
+ */
+bg_err_t bg_send_data_async(uint32_t timeout, const uint8_t *data, uint16_t len, bg_cmdCallback_t callback, void *ctx,\
+	const char *fmt, ...);
+
+/**
+ * @brief Avanza el motor de comandos AT: procesa lo recibido, envia el siguiente comando encolado, detecta
+ * el fin o el timeout del comando en curso y llama a su callback. No bloquea.
+ * 
+ * NOTE: Se debe llamar en el ciclo principal de la aplicacion (bg_handle_urc() tambien la llama).
+ */
+void bg_poll(void);
+
+/**
+ * @brief Indica el numero de comandos AT asincronos pendientes (en curso y en espera).
+ * 
+ * @return uint8_t Numero de comandos pendientes.
+ */
+uint8_t bg_cmd_pending(void);
+
+/**
+ * @brief Tipo de variable que describe un comando de un lote de comandos AT (bg_send_batch()).
+ * 
+ */
+typedef struct
+{
+	const char *cmd;	//Comando AT completo (ej. "AT+CEREG?")
+	uint32_t timeout;	//Tiempo de espera (ms) del comando
+	uint8_t concat;		//1: se puede concatenar con ';' con sus vecinos, 0: se envia solo (comandos basicos como ATE0, AT&W,
+						//o comandos cuya respuesta no inicia con "+<nombre>:" como AT+GMR)
+	uint8_t *resp;		//Buffer (opcional) donde se copia la respuesta. Si se envio solo es la respuesta completa,
+						//si se concateno son solo sus lineas "+<nombre>: ..."
+	uint16_t respSize;	//Tamaño de resp
+	bg_err_t err;		//Salida: resultado del comando
+	uint8_t done;		//Salida: 1 cuando el comando termino
+}bg_batchCmd_t;
+
+/**
+ * @brief Envia un lote de comandos AT con el menor numero de viajes posible. Los comandos consecutivos con concat = 1
+ * se envian en una sola linea "AT+CMD1;+CMD2;..." (hasta BG_CMD_MAX_LEN) y la respuesta combinada se reparte a cada
+ * comando por el nombre de sus lineas "+<nombre>:". Los comandos con concat = 0 se encolan uno tras otro en el motor
+ * de comandos para que se envien sin esperas entre ellos.
+ * 
+ * NOTE: Si una linea concatenada responde con error (el modulo deja de ejecutar en el comando que fallo) sus comandos
+ * se vuelven a enviar uno por uno para obtener el resultado de cada uno.
+ * @param batch Arreglo de comandos, al terminar cada uno tiene su resultado en err y su respuesta en resp.
+ * @param nCmds Numero de comandos del arreglo.
+ * @return bg_err_t BG_OK si todos los comandos respondieron OK, el primer error encontrado en caso contrario. Ante un
+ * error que no es del modulo (timeout o UART) se detiene el lote.
+ */
+bg_err_t bg_send_batch(bg_batchCmd_t *batch, uint8_t nCmds);
+
+/**
+ * @brief Enciende el modulo de comunicacion sin retardos fijos. Primero prueba con "AT" si el modulo ya esta
+ * encendido (ej. despues de un reset del MCU) y en ese caso no toca los pines. Si no contesta, da un pulso de
+ * BG_PWRKEY_PIN (o de BG_RESET_PIN si el pin STATUS indica que ya esta encendido) y espera el URC RDY/APP RDY
+ * o el pin STATUS en lugar de un tiempo fijo.
  * 
  * @return bg_err_t Devuelve el codigo de error basado en el tipo bg_err_t. Si todo esta bien se espera BG_OK
  */
@@ -837,9 +1086,35 @@ bg_err_t bg_power_on(void);
  */
 bg_err_t bg_power_off(void);
 
+/**
+ * @brief Tipo de variable que describe un parametro de un perfil de configuracion declarativo (bg_apply_config()).
+ * 
+ */
+typedef struct
+{
+	const char *query;	//Comando de lectura del valor actual (ej. "AT+CMEE?"), NULL si no se puede leer y se envia siempre
+	const char *expect;	//Texto que aparece en la respuesta de query cuando ya se tiene el valor deseado (sin distinguir mayusculas)
+	const char *set;	//Comando que establece el valor deseado (ej. "AT+CMEE=1")
+	uint8_t persist;	//1: el valor se guarda en NV con AT&W, 0: el modulo lo guarda solo o el valor no es persistente
+}bg_cfgItem_t;
+
+/**
+ * @brief Aplica un perfil de configuracion declarativo. Lee los valores actuales de todos los parametros (en una
+ * linea concatenada), envia solo los que son distintos al valor deseado y ejecuta AT&W0 solo si cambio algun
+ * parametro con persist = 1.
+ * 
+ * NOTE: Si expect no coincide con el formato de lectura del firmware el parametro simplemente se vuelve a enviar.
+ * @param profile Arreglo de parametros del perfil.
+ * @param nItems Numero de parametros (maximo BG_CFG_MAX_ITEMS).
+ * @return bg_err_t BG_OK si el modulo respondio (los parametros no aceptados solo se reportan en el Log) o el codigo
+ * de error correspondiente.
+ */
+bg_err_t bg_apply_config(const bg_cfgItem_t *profile, uint8_t nItems);
+
 /**
  * @brief Funcion para inicializar el modulo. 
- *	Sus funciones son encender y configurar el modulo.
+ *	Sus funciones son encender y configurar el modulo. Si despues de BG_POWER_ON_ATTEMPTS intentos el modulo
+ *	no enciende se reinicia el MCU.
  * 
  * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. Si todo esta bien se espera BG_OK
  */
@@ -892,7 +1167,8 @@ bg_err_t bg_query_cops(void);
 bg_err_t bg_query_conf_pdp(uint8_t contextID);
 
 /**
- * @brief Verifica que se tenga activado el contexto PDP seleccionado (contextID)
+ * @brief Verifica que se tenga activado el contexto PDP seleccionado (contextID). Todas las lineas de AT+QIACT?
+ * se guardan en la tabla de contextos PDP (bg_get_pdp_info()).
  * 
  * @param ctxtID Es el numero de contexto que se quiere verificar (rango 1-7).
  * 
@@ -902,8 +1178,10 @@ bg_err_t bg_query_conf_pdp(uint8_t contextID);
 bg_err_t bg_check_pdp(uint8_t ctxtID);
 
 /**
- * @brief Verifica el estado de una conexion
+ * @brief Verifica el estado de una conexion consultando al modulo (AT+QISTATE=1,<connectID>) y actualiza su
+ * renglon de la tabla de sockets.
  * 
+ * NOTE: Para conocer el estado sin trafico por UART se usa bg_get_sckt_state() o bg_get_sckt_info().
  * @param connectID el numero de conexion (rango 0-11)
  * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. 
  * Si la conexion esta abierta devuelve BG_OK_CONNECT_ID_OPENNED.
@@ -1008,18 +1286,22 @@ bg_err_t bg_pdp_activation(uint8_t ctxtID, bg_actPdp_t act);
 #define BG_OPEN_SERVER_IP "127.0.0.1" //Esta MACRO especifica la direccion IP en modo Servidor.
 
 #define BG_OPEN_BUFF_ACCSS_MODE 0	//Esta MACRO especifica que se quiere usar el modo de acceso en buffer acces mode.
+#define BG_OPEN_DIRECT_PUSH_MODE 1	//Esta MACRO especifica que se quiere usar el modo de acceso direct push mode (los datos llegan dentro del URC "recv").
 #define BG_OPEN_TRANSPARENT_MODE 2	//Esta MACRO especifica que se quiere usar el modo de acceso en modo transparente.
 
 #define BG_OPEN_CLIENT_LOCAL_PORT 0	//Esta MACRO especifica el puetro local automatico en modo Cliente.
 
 /**
- * @brief Es el tipo de dato para seleccionar el tipo de servicio en una apertura de conexion (Cliente o Servidor TCP).
+ * @brief Es el tipo de dato para seleccionar el tipo de servicio en una apertura de conexion (Cliente o Servidor TCP,
+ * Cliente UDP o UDP SERVICE).
  * 
  */
 typedef enum
 {
 	BG_OPEN_SERVER,	//Opcion para abrir conexion en modo Servidor.
-	BG_OPEN_CLIENT	//Opcion para abrir conexion en modo Cliente.
+	BG_OPEN_CLIENT,	//Opcion para abrir conexion en modo Cliente.
+	BG_OPEN_UDP,	//Opcion para abrir un socket UDP con destino fijo (ip y remotePort).
+	BG_OPEN_UDP_SERVICE	//Opcion para abrir un socket UDP en localPort que envia y recibe de cualquier direccion.
 }bgServiceType_t;
 
 /**
@@ -1030,16 +1312,16 @@ typedef struct
 {
 	uint8_t ctxtID; //contextID del contexto PDP que se activo
 	uint8_t connectID; //connectID es el numero de conexion. Sirve para identificar conexiones (rango 0-11)
-	bgServiceType_t serviceType; //Es el tipo de conexion a abrir (TCP Cliente o TCP Servidor)
-	uint8_t *ip; //Direccion IP de destino cuando la conexion es Cliente
-	uint32_t remotePort; //Puerto remoto al que se quiere apuntar cuando la conexion es Cliente
-	uint32_t localPort; //Puerto local del dispositivo se utiliza cuando la conexion es Servidor (en modo Cliente por defecto es 0)
-	uint32_t accssMode; //Selecciona la opcion de modo de acceso Buffer acces mode o Transparent mode (las conexiones cliente son las que pueden iniciar como Transparent mode)
+	bgServiceType_t serviceType; //Es el tipo de conexion a abrir (TCP Cliente, TCP Servidor, UDP o UDP SERVICE)
+	uint8_t *ip; //Direccion IP de destino cuando la conexion es Cliente o UDP
+	uint32_t remotePort; //Puerto remoto al que se quiere apuntar cuando la conexion es Cliente o UDP
+	uint32_t localPort; //Puerto local del dispositivo se utiliza cuando la conexion es Servidor o UDP SERVICE (en modo Cliente por defecto es 0)
+	uint32_t accssMode; //Selecciona la opcion de modo de acceso Buffer acces mode, Direct push mode o Transparent mode (las conexiones cliente son las que pueden iniciar como Transparent mode)
 }bgSckt_t;
 
 
 /**
- * @brief Abre una conexion (socket) TCP en modo servidor o cliente.
+ * @brief Abre una conexion (socket) TCP en modo servidor o cliente, o un socket UDP (cliente o UDP SERVICE).
  * 
  * @param sckt Es una estructura de datos que contiene todos los parametros necesarios para abrir una conexion.
  * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. Si el modulo consigue 
@@ -1047,8 +1329,133 @@ typedef struct
  */
 bg_err_t bg_open_sckt(bgSckt_t sckt);
 
+/**
+ * @brief Tipo de dato para crear un puntero a funcion de callback de fin de apertura asincrona.
+ * 
+ * @param connectID numero de conexion que termino de abrir.
+ * @param err BG_OK_CONNECT_ID_OPENNED, BG_ERR_OPEN_SCKT (+QIOPEN con error o sin URC en BG_OPEN_TIMEOUT) o
+ * el error del comando AT+QIOPEN.
+ * @param ctx Es el puntero de contexto que se entrego en bg_open_sckt_async().
+ */
+typedef void (*bg_openCallback_t)(uint8_t connectID, bg_err_t err, void *ctx);
+
+/**
+ * @brief Encola AT+QIOPEN y regresa sin esperar el resultado. El socket queda en BG_SCKT_STATE_OPENING y al
+ * llegar +QIOPEN (se aplica en bg_handle_urc(void), sin pasar por la cola de URC) se llama a callback. Varias aperturas se pueden
+ * encolar seguidas, el tiempo total es el de la conexion mas lenta y no la suma de todas.
+ * 
+ * NOTE: Si no llega +QIOPEN en BG_OPEN_TIMEOUT se encola AT+QICLOSE (el modulo podria seguir conectando),
+ * el socket sigue en BG_SCKT_STATE_OPENING y al terminar el cierre vuelve a BG_SCKT_STATE_INITIAL y se llama a
+ * callback con BG_ERR_OPEN_SCKT. Un +QIOPEN que llegue mientras tanto se ignora.
+ * @param sckt parametros de la conexion (se copian, no tiene que existir despues de la llamada).
+ * @param callback funcion que recibe el resultado (puede ser NULL, el resultado queda en la tabla de sockets).
+ * @param ctx puntero que se entrega a callback.
+ * @return bg_err_t BG_OK si se encolo, BG_ERR_CMD_QUEUE_FULL, BG_ERR_CONNECT_ID_UNSUPORTED, BG_ERR_OPEN_SCKT si
+ * el connectID ya tiene una apertura en curso o el error del formato del comando.
+ */
+bg_err_t bg_open_sckt_async(const bgSckt_t *sckt, bg_openCallback_t callback, void *ctx);
+
+/**
+ * @brief Abre varios sockets en paralelo con bg_open_sckt_async() y espera a que todos terminen. Mientras espera
+ * solo atiende la cola de comandos y los +QIOPEN, los demas URC quedan en la cola para bg_handle_urc(void).
+ * 
+ * @param sckt arreglo de conexiones a abrir (connectID distintos).
+ * @param n numero de conexiones.
+ * @param result arreglo de n resultados, uno por conexion (puede ser NULL).
+ * @return bg_err_t BG_OK_CONNECT_ID_OPENNED si se abrieron todas o el primer error en el orden de sckt.
+ */
+bg_err_t bg_open_sckts(const bgSckt_t *sckt, uint8_t n, bg_err_t *result);
+
+/**
+ * @brief Reserva el connectID libre mas bajo. Un connectID esta libre si no esta reservado y su socket esta en
+ * BG_SCKT_STATE_INITIAL en la tabla de sockets, por lo que no choca con sockets abiertos con un connectID fijo.
+ * 
+ * NOTE: bg_close_sckt() libera la reserva. Al reiniciar o apagar el modulo se liberan todas.
+ * @param connectID variable donde se guarda el connectID reservado.
+ * @return bg_err_t BG_OK o BG_ERR_CONNECT_ID_UNSUPORTED si no hay connectID libre.
+ */
+bg_err_t bg_alloc_connect_id(uint8_t *connectID);
+
+/**
+ * @brief Libera un connectID reservado con bg_alloc_connect_id() que no se llego a abrir.
+ * 
+ * @param connectID numero de conexion.
+ */
+void bg_free_connect_id(uint8_t connectID);
+
+/**
+ * @brief Tipo de variable con las estadisticas del pool de conexiones.
+ * 
+ */
+typedef struct
+{
+	uint32_t hits;			//bg_pool_acquire() que reutilizaron un socket abierto
+	uint32_t misses;		//bg_pool_acquire() que abrieron un socket
+	uint32_t expired;		//sockets cerrados por estar sin uso BG_POOL_IDLE_MS
+	uint32_t peerClosed;	//sockets del pool cerrados por el punto remoto (+QIURC: "closed")
+	uint32_t evicted;		//sockets sin uso cerrados para liberar un connectID
+}bg_poolStats_t;
+
+/**
+ * @brief Entrega un socket cliente TCP conectado a sckt->ip:sckt->remotePort. Si el pool tiene uno sin uso y
+ * conectado con los mismos parametros se reutiliza (sin AT+QIOPEN), si no se abre uno con un connectID de
+ * bg_alloc_connect_id(). Si no hay connectID libre se cierra el socket del pool que lleva mas tiempo sin uso.
+ * 
+ * @param sckt parametros de la conexion (serviceType BG_OPEN_CLIENT, el connectID se ignora).
+ * @param connectID variable donde se guarda el connectID entregado.
+ * @return bg_err_t BG_OK_CONNECT_ID_OPENNED o el error de la apertura.
+ */
+bg_err_t bg_pool_acquire(const bgSckt_t *sckt, uint8_t *connectID);
+
+/**
+ * @brief Regresa al pool un socket de bg_pool_acquire(). Si sigue conectado queda abierto para la siguiente
+ * peticion al mismo destino (hasta BG_POOL_IDLE_MS sin uso), si el punto remoto lo cerro se cierra y se libera.
+ * 
+ * @param connectID numero de conexion.
+ * @return bg_err_t BG_OK, el error de bg_close_sckt() o BG_ERR_CONNECT_ID_NOT_USED si no es un socket del pool.
+ */
+bg_err_t bg_pool_release(uint8_t connectID);
+
+/**
+ * @brief Devuelve las estadisticas del pool de conexiones.
+ * 
+ * @return bg_poolStats_t Copia de las estadisticas.
+ */
+bg_poolStats_t bg_get_pool_stats(void);
+
+/**
+ * @brief Establece el tiempo de espera de modo transparente (AT+QICFG="transwaittm"): si no llegan datos por UART
+ * durante waitTime x 100ms el modulo envia lo acumulado. El valor se guarda en la libreria y se configura en el
+ * modulo en la siguiente llamada a bg_transparent_mode(), solo si es distinto al que ya tiene.
+ * 
+ * @param waitTime Tiempo de espera en unidades de 100ms (0-BG_TM_WAIT_TIME_MAX), por defecto BG_TM_WAIT_TIME.
+ * @return bg_err_t BG_OK o BG_ERR_TM_WAIT_TIME si esta fuera de rango.
+ */
+bg_err_t bg_set_tm_wait_time(uint8_t waitTime);
+
+/**
+ * @brief Tipo de variable con la politica de regreso a modo transparente despues de una salida (bg_callback_TM_Inactive()).
+ * 
+ */
+typedef struct
+{
+	uint32_t delayMs;		//tiempo sin URC despues de la salida antes del primer intento (histeresis)
+	uint32_t maxDelayMs;	//espera maxima entre intentos, la espera se duplica despues de cada intento fallido
+	uint8_t maxTries;		//intentos despues de cada salida, 0 para no llamar nunca a bg_callback_TM_Inactive()
+}bg_tmReentry_t;
+
+/**
+ * @brief Establece la politica de regreso a modo transparente. Por defecto: BG_TM_REENTRY_DELAY_MS,
+ * BG_TM_REENTRY_MAX_DELAY_MS y BG_TM_REENTRY_MAX_TRIES.
+ * 
+ * @param policy Politica de regreso a modo transparente.
+ */
+void bg_set_tm_reentry(bg_tmReentry_t policy);
+
 /**
  * @brief Permite al dispositio cambiar su modo de acceso a modo transparente.
+ * La configuracion de modo transparente solo se envia si cambio (o despues de encender el modulo), normalmente
+ * solo se envia AT+QISWTMD y se espera CONNECT.
  * 
  * @param connectID Es el numero de conexion que se desea cambiar a modo transparente.
  * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. Si el modulo consigue entrar
@@ -1058,9 +1465,199 @@ bg_err_t bg_transparent_mode(uint8_t connectID);
 //-----------------------Funciones de apertura de socket end------------------------
 
 
+//-----------------------------------Tabla de sockets--------------------------------
+#define BG_SCKT_IP_LEN 40 //Tamaño de la direccion IP remota en la tabla de sockets (IPv6 con terminador nulo)
+
+/**
+ * @brief Tipo de variable con el estado de un socket, los valores son los de <socket_state> de AT+QISTATE.
+ * 
+ */
+typedef enum
+{
+	BG_SCKT_STATE_INITIAL,		//Sin conexion (connectID libre)
+	BG_SCKT_STATE_OPENING,		//Se envio AT+QIOPEN y no ha llegado +QIOPEN
+	BG_SCKT_STATE_CONNECTED,	//Conexion establecida
+	BG_SCKT_STATE_LISTENING,	//Servidor escuchando
+	BG_SCKT_STATE_CLOSING		//El punto remoto cerro (o se desactivo el contexto PDP), falta AT+QICLOSE
+}bg_scktState_t;
+
+/**
+ * @brief Tipo de variable con el tipo de servicio de un socket (<service_type> de AT+QISTATE).
+ * 
+ */
+typedef enum
+{
+	BG_SCKT_SERVICE_TCP,			//"TCP" cliente
+	BG_SCKT_SERVICE_UDP,			//"UDP" cliente
+	BG_SCKT_SERVICE_TCP_LISTENER,	//"TCP LISTENER" servidor
+	BG_SCKT_SERVICE_TCP_INCOMING,	//"TCP INCOMING" conexion aceptada por un servidor
+	BG_SCKT_SERVICE_UDP_SERVICE,	//"UDP SERVICE"
+	BG_SCKT_SERVICE_UNKNOWN
+}bg_scktService_t;
+
+/**
+ * @brief Tipo de variable con la informacion de un connectID en la tabla de sockets.
+ * 
+ */
+typedef struct
+{
+	bg_scktState_t state;
+	bg_scktService_t service;
+	uint8_t ctxtID;				//contextID del socket
+	uint8_t serverID;			//connectID del servidor que acepto la conexion (solo TCP INCOMING)
+	uint8_t accssMode;			//BG_OPEN_BUFF_ACCSS_MODE, BG_OPEN_DIRECT_PUSH_MODE o BG_OPEN_TRANSPARENT_MODE
+	uint8_t ip[BG_SCKT_IP_LEN];	//Direccion IP remota
+	uint32_t remotePort;
+	uint32_t localPort;
+	uint32_t txBytes;			//Bytes enviados con la libreria desde que se abrio
+	uint32_t rxBytes;			//Bytes recibidos con la libreria desde que se abrio
+	uint32_t updatedMs;			//Instante (bg_get_tick_ms()) de la ultima actualizacion
+}bg_scktInfo_t;
+
+/**
+ * @brief Devuelve el estado de un socket desde la tabla de sockets, sin enviar nada al modulo.
+ * 
+ * La tabla se actualiza con AT+QIOPEN/+QIOPEN, los URC "closed", "incoming" y "pdpdeact", bg_close_sckt(),
+ * bg_check_sckt() y al encender o apagar el modulo.
+ * 
+ * @param connectID Es el numero de conexion (rango 0-11).
+ * @return bg_scktState_t Estado del socket (BG_SCKT_STATE_INITIAL si el connectID no esta soportado).
+ */
+bg_scktState_t bg_get_sckt_state(uint8_t connectID);
+
+/**
+ * @brief Devuelve el renglon de la tabla de sockets de un connectID, sin enviar nada al modulo.
+ * 
+ * @param connectID Es el numero de conexion (rango 0-11).
+ * @return const bg_scktInfo_t* Informacion del socket o NULL si el connectID no esta soportado.
+ */
+const bg_scktInfo_t *bg_get_sckt_info(uint8_t connectID);
+
+/**
+ * @brief Tipo de variable con el estado de un contexto PDP (linea "+QIACT: " de AT+QIACT?).
+ * 
+ */
+typedef struct
+{
+	uint8_t active;				//1: contexto activado
+	bgCtxtType_t ctxtType;		//Tipo de contexto (valido con active = 1)
+	uint8_t ip[BG_SCKT_IP_LEN];	//Direccion IP local del contexto
+	uint32_t updatedMs;			//Instante (bg_get_tick_ms()) de la ultima actualizacion
+}bg_pdpInfo_t;
+
+/**
+ * @brief Actualiza la tabla de sockets y la de contextos PDP con un solo viaje al modulo: la lista completa de
+ * AT+QISTATE (o AT+QISTATE=0,<contextID>) y AT+QIACT? se envian concatenados y se parsean todas sus lineas.
+ * Los connectID que no aparecen en la lista quedan en BG_SCKT_STATE_INITIAL (salvo los que esperan +QIOPEN).
+ * 
+ * @param ctxtID Contexto PDP cuyos sockets se consultan (rango 1-7) o 0 para todos los sockets.
+ * @return bg_err_t BG_OK si se actualizaron las tablas, BG_ERR_CTXT_ID_UNSUPPORTED o el error del comando.
+ */
+bg_err_t bg_refresh_sckt_table(uint8_t ctxtID);
+
+/**
+ * @brief Devuelve el estado de un contexto PDP desde la tabla de contextos, sin enviar nada al modulo.
+ * La tabla se actualiza con bg_check_pdp(), bg_refresh_sckt_table(), el arranque de red y el URC "pdpdeact".
+ * 
+ * @param ctxtID Es el numero de contexto (rango 1-7).
+ * @return const bg_pdpInfo_t* Estado del contexto o NULL si el contextID no esta soportado.
+ */
+const bg_pdpInfo_t *bg_get_pdp_info(uint8_t ctxtID);
+//-----------------------------------Tabla de sockets end----------------------------
+
+
+//-----------------------------------Arranque de red---------------------------------
+/**
+ * @brief Tipo de variable que enlista las etapas del arranque de red. Las etapas hasta BG_BRINGUP_SOCKETS
+ * se indexan en los tiempos de bg_bringupStats_t.
+ * 
+ */
+typedef enum
+{
+	BG_BRINGUP_POWER,		//Encendido y perfil de configuracion (bg_init_module)
+	BG_BRINGUP_SIM,			//Espera de +CPIN: READY
+	BG_BRINGUP_PDP_CONF,	//Configuracion del contexto PDP (AT+QICSGP), en paralelo con SIM y registro
+	BG_BRINGUP_ATTACH,		//Registro en la red (+CEREG: 1 o 5)
+	BG_BRINGUP_PDP_ACT,		//Activacion del contexto PDP (AT+QIACT)
+	BG_BRINGUP_SOCKETS,		//Apertura de sockets (+QIOPEN: <connectID>,0 de todos los sockets)
+	BG_BRINGUP_DONE,		//Arranque terminado (tambien es el numero de etapas)
+	BG_BRINGUP_FAIL,		//Alguna etapa fallo o excedio su timeout
+	BG_BRINGUP_IDLE			//No se ha iniciado el arranque
+}bg_bringupStage_t;
+
+/**
+ * @brief Tipo de variable con la configuracion de red del arranque.
+ * 
+ * NOTE: La variable (y el arreglo de sockets) debe existir mientras dura el arranque.
+ */
+typedef struct
+{
+	uint8_t *operator;	//Operadora para AT+COPS=4 (como bg_attach()), NULL para registro automatico
+	bg_ctxPdp_t pdp;	//Contexto PDP a configurar y activar
+	bgSckt_t *sckt;		//Sockets que se abren al final del arranque (NULL si no hay)
+	uint8_t nSckt;		//Numero de sockets (maximo BG_CONNECT_ID_MAX + 1)
+}bg_bringupCfg_t;
+
+/**
+ * @brief Tipo de variable con el estado y las metricas de tiempo del arranque de red. Los tiempos son en ms
+ * y relativos a bg_bringup_start().
+ * 
+ */
+typedef struct
+{
+	bg_bringupStage_t stage;				//Etapa mas antigua sin terminar, BG_BRINGUP_DONE o BG_BRINGUP_FAIL
+	bg_bringupStage_t failStage;			//Etapa que fallo (valido con stage = BG_BRINGUP_FAIL)
+	bg_err_t err;							//Error de la etapa que fallo
+	uint32_t startMs[BG_BRINGUP_DONE];		//Inicio de cada etapa
+	uint32_t durationMs[BG_BRINGUP_DONE];	//Duracion de cada etapa (0 mientras no termina)
+	uint32_t readyMs;						//Tiempo hasta que todos los sockets quedaron abiertos (listo para el primer byte)
+}bg_bringupStats_t;
+
+/**
+ * @brief Inicia el arranque de red: encendido y configuracion, SIM, registro, contexto PDP y apertura de sockets.
+ * El avance se hace con bg_bringup_step() y ninguna etapa bloquea.
+ * 
+ * NOTE: La etapa BG_BRINGUP_POWER hace los pasos de bg_init_module() por subetapas: "AT", pulso de PWRKEY (o
+ * RESET_N) y espera de RDY (o del pin STATUS) con instantes limite. Solo el perfil de configuracion se envia de forma
+ * sincrona (comandos de respuesta inmediata). Si el modulo no arranca en BG_POWER_ON_ATTEMPTS pulsos la etapa falla
+ * con BG_ERR_TIMEOUT_ANS_DESIRED en lugar de reiniciar el MCU.
+ * 
+ * Las etapas independientes se traslapan: AT+QICSGP se envia al terminar el encendido (mientras el modulo
+ * detecta la SIM y se registra) y los AT+QIOPEN de todos los sockets se encolan juntos. SIM, registro y
+ * sockets avanzan con los URC +CPIN, +CEREG y +QIOPEN; AT+CPIN? y AT+CEREG? solo se consultan cada
+ * BG_BRINGUP_POLL_MS como respaldo.
+ * 
+ * NOTE: Si hay comandos de un arranque anterior en la cola, se espera a que terminen.
+ * @param cfg Configuracion de red (debe existir mientras dura el arranque).
+ * @return bg_err_t BG_OK si se inicio, BG_ERR_MCU_PTR_NULL, BG_ERR_CTXT_ID_UNSUPPORTED o BG_ERR_CONNECT_ID_UNSUPORTED
+ * si la configuracion no es valida.
+ */
+bg_err_t bg_bringup_start(const bg_bringupCfg_t *cfg);
+
+/**
+ * @brief Avanza el arranque de red. Se llama en el ciclo principal en lugar de bg_handle_urc(void) (la llama
+ * internamente) y regresa enseguida.
+ * 
+ * @return bg_bringupStage_t Etapa en curso, BG_BRINGUP_DONE al terminar o BG_BRINGUP_FAIL (el detalle esta
+ * en bg_get_bringup_stats()).
+ */
+bg_bringupStage_t bg_bringup_step(void);
+
+/**
+ * @brief Devuelve el estado y los tiempos por etapa del ultimo arranque de red.
+ * 
+ * @return bg_bringupStats_t Copia de las metricas del arranque.
+ */
+bg_bringupStats_t bg_get_bringup_stats(void);
+//-----------------------------------Arranque de red end-----------------------------
+
+
 //-----------------------Funciones de cierre y desactivacion-------------------------
 /**
- * @brief Hace que el dispositivo salga de modo transparente
+ * @brief Hace que el dispositivo salga de modo transparente. Con MAIN_DTR (bg_bspFun_t.dtrPin = 1) genera el
+ * flanco ON->OFF de DTR (AT&D1). Sin DTR envia "+++" y solo espera lo que falte del tiempo de guarda
+ * (BG_TM_GUARD_MS) desde el ultimo byte enviado con bg_transmit_TM(). En ambos casos regresa en cuanto llega OK.
+ * Si el modulo no esta en modo datos (no entro a TM o ya llego NO CARRIER) regresa sin enviar el escape.
  * 
  * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. Si el modulo consigue salir
  * de modo transpoarente retornara BG_OK_EXIT_TRANSPARENT_MODE.
@@ -1091,6 +1688,8 @@ bg_err_t bg_detach(void);
 /**
  * @brief Funcion para transmitir mensajes por un socket que esta en modo buffer access mode
  * 
+ * NOTE: Si el socket tiene habilitado el envio agrupado (bg_set_tx_coalesce()) los datos se copian a su buffer
+ * y se regresa BG_OK_TRANSMIT sin esperar SEND OK, el AT+QISEND se hace al llegar al umbral o al plazo.
  * @param connectID numero de conexion a la que se quiere transmitir el mensaje.
  * @param data puntero al buffer que contiene el dato a transmitir.
  * @param len numero de bytes que se quieren transmitir del buffer.
@@ -1100,20 +1699,199 @@ bg_err_t bg_detach(void);
 bg_err_t bg_transmit_buffAMode(uint8_t connectID, uint8_t *data, uint16_t len);
 
 /**
- * @brief Funcion que se encarga de recuperar los datos recibidos por una conexion en buffer access mode
+ * @brief Igual que bg_transmit_buffAMode() pero el mensaje esta formado por varios segmentos. Se anuncia la longitud
+ * total en AT+QISEND y al recibir el prompt '>' los segmentos se transmiten uno tras otro (o con uartTxv del BSP),
+ * sin copiarlos a un buffer intermedio.
+ * 
+ * @param connectID numero de conexion a la que se quiere transmitir el mensaje.
+ * @param iov arreglo de segmentos del mensaje.
+ * @param iovCnt numero de segmentos.
+ * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. Si se consigue enviar el mensaje
+ * devuelve BG_OK_TRANSMIT, si la suma de los segmentos excede BG_QISEND_MAX_LEN devuelve BG_ERR_SEND_LEN.
+ */
+bg_err_t bg_transmit_buffAMode_iov(uint8_t connectID, const bg_iovec_t *iov, uint8_t iovCnt);
+
+/**
+ * @brief Tipo de variable con el resultado de un envio grande (bg_transmit_large()).
+ * 
+ */
+typedef struct
+{
+	uint32_t bytes;			//Bytes aceptados por el modulo (SEND OK)
+	uint32_t acked;			//Bytes del envio con ACK del punto remoto al terminar (AT+QISEND=<connectID>,0)
+	uint32_t elapsedMs;		//Duracion del envio
+	uint32_t goodputBps;	//bytes * 1000 / elapsedMs
+	uint16_t segments;		//AT+QISEND de datos enviados
+	uint16_t paceWaits;		//Consultas que encontraron mas de BG_TX_UNACKED_MAX bytes sin ACK
+}bg_largeSendStats_t;
+
+/**
+ * @brief Envia un buffer de cualquier tamaño por un socket TCP en buffer access mode. El buffer se parte en
+ * segmentos de BG_QISEND_MAX_LEN y se mantienen BG_TX_PIPELINE_DEPTH AT+QISEND en la cola del motor de comandos,
+ * de manera que el siguiente se envia en cuanto llega el SEND OK del anterior.
+ * 
+ * Cada BG_TX_UNACKED_MAX / 2 bytes se consulta AT+QISEND=<connectID>,0. Si el punto remoto tiene mas de
+ * BG_TX_UNACKED_MAX bytes sin ACK se pausa el envio (consultando cada BG_TX_PACE_MS) para no llenar el buffer de
+ * TX del modulo (SEND FAIL).
+ * 
+ * NOTE: Si el socket tiene envio agrupado, lo pendiente se envia antes. Ante un error se detiene el envio, stats
+ * indica cuantos bytes se aceptaron.
+ * @param connectID numero de conexion.
+ * @param data buffer a enviar (debe ser valido hasta que la funcion regrese).
+ * @param len numero de bytes de data.
+ * @param stats variable donde se guarda el resultado (puede ser NULL).
+ * @return bg_err_t BG_OK_TRANSMIT si se enviaron todos los bytes o el error del primer segmento que fallo.
+ */
+bg_err_t bg_transmit_large(uint8_t connectID, const uint8_t *data, uint32_t len, bg_largeSendStats_t *stats);
+
+/**
+ * @brief Tipo de variable con la direccion de origen o destino de un datagrama UDP.
+ * 
+ */
+typedef struct
+{
+	uint8_t ip[BG_SCKT_IP_LEN];
+	uint16_t port;
+}bg_udpAddr_t;
+
+/**
+ * @brief Tipo de variable que describe un datagrama de bg_transmit_udp_batch().
+ * 
+ */
+typedef struct
+{
+	const uint8_t *data;
+	uint16_t len;			//Maximo BG_QISEND_MAX_LEN
+	const uint8_t *ip;		//Destino (solo UDP SERVICE), NULL para el destino fijo de un socket BG_OPEN_UDP
+	uint16_t port;
+}bg_udpDgram_t;
+
+/**
+ * @brief Envia un datagrama por un socket UDP. En UDP SERVICE se usa AT+QISEND=<connectID>,<len>,"<ip>",<port>.
+ * 
+ * @param connectID numero de conexion.
+ * @param ip direccion de destino (solo UDP SERVICE), NULL para el destino fijo de un socket BG_OPEN_UDP.
+ * @param port puerto de destino (solo UDP SERVICE).
+ * @param data datagrama a enviar.
+ * @param len numero de bytes del datagrama (maximo BG_QISEND_MAX_LEN).
+ * @return bg_err_t BG_OK_TRANSMIT si el modulo respondio SEND OK.
+ */
+bg_err_t bg_transmit_udp(uint8_t connectID, const uint8_t *ip, uint16_t port, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Envia varios datagramas por un socket UDP en una sola llamada. Se mantienen BG_TX_PIPELINE_DEPTH AT+QISEND
+ * en la cola del motor de comandos, por lo que el siguiente datagrama se envia al llegar el SEND OK del anterior.
+ * 
+ * NOTE: Un datagrama que falla no detiene el lote (UDP no garantiza orden ni entrega).
+ * @param connectID numero de conexion.
+ * @param dgram arreglo de datagramas (deben ser validos hasta que la funcion regrese).
+ * @param cnt numero de datagramas.
+ * @param sent variable donde se guarda cuantos datagramas respondieron SEND OK (puede ser NULL).
+ * @return bg_err_t BG_OK_TRANSMIT si se enviaron todos o el error del primer datagrama que fallo.
+ */
+bg_err_t bg_transmit_udp_batch(uint8_t connectID, const bg_udpDgram_t *dgram, uint8_t cnt, uint8_t *sent);
+
+/**
+ * @brief Tipo de variable con las estadisticas de envio agrupado de un socket.
+ * 
+ */
+typedef struct
+{
+	uint32_t writes;			//Llamadas a bg_transmit_buffAMode()
+	uint32_t bytes;				//Bytes recibidos de la aplicacion
+	uint32_t sends;				//AT+QISEND enviados (writes / sends es el factor de agrupacion)
+	uint32_t flushThreshold;	//Envios por llegar al umbral
+	uint32_t flushTimer;		//Envios por cumplirse el plazo
+	uint32_t flushExplicit;		//Envios por bg_flush_buffAMode() o bg_close_sckt()
+	uint32_t flushPoolClose;	//Envios antes de que bg_pool_poll() cierre un socket del pool
+	uint32_t errors;			//AT+QISEND que fallaron (sus bytes se pierden)
+}bg_txCoalesceStats_t;
+
+/**
+ * @brief Habilita el envio agrupado de un socket en buffer access mode. Las escrituras pequeñas de
+ * bg_transmit_buffAMode() se juntan en un buffer y se envian en un solo AT+QISEND cuando se acumulan
+ * threshold bytes o cuando pasan flushMs desde la primera escritura pendiente (se revisa en bg_handle_urc(void)).
+ * Los AT+QISEND se encolan en el motor de comandos y no bloquean.
+ * 
+ * NOTE: Los buffers se toman de un grupo de BG_TX_POOL_LEN compartido por todos los sockets. Si no hay buffer
+ * libre bg_transmit_buffAMode() espera a que termine un envio.
+ * @param connectID Es el numero de conexion (rango 0-11).
+ * @param threshold Bytes que disparan el envio (maximo BG_QISEND_MAX_LEN), 0 deshabilita y envia lo pendiente.
+ * @param flushMs Tiempo maximo (ms) que un byte espera en el buffer.
+ * @return bg_err_t BG_OK o BG_ERR_CONNECT_ID_UNSUPORTED.
+ */
+bg_err_t bg_set_tx_coalesce(uint8_t connectID, uint16_t threshold, uint32_t flushMs);
+
+/**
+ * @brief Envia lo pendiente del buffer de envio agrupado de un socket y espera el SEND OK de todos sus envios.
+ * 
+ * @param connectID Es el numero de conexion (rango 0-11).
+ * @return bg_err_t BG_OK_TRANSMIT si todo se envio, el error del ultimo AT+QISEND que fallo en caso contrario.
+ */
+bg_err_t bg_flush_buffAMode(uint8_t connectID);
+
+/**
+ * @brief Devuelve las estadisticas de envio agrupado de un socket.
+ * 
+ * @param connectID Es el numero de conexion (rango 0-11).
+ * @return bg_txCoalesceStats_t Copia de las estadisticas (en 0 si el connectID no esta soportado).
+ */
+bg_txCoalesceStats_t bg_get_tx_coalesce_stats(uint8_t connectID);
+
+/**
+ * @brief Funcion que se encarga de recuperar los datos recibidos por una conexion en buffer access mode. Lee
+ * un solo bloque de hasta BG_QIRD_CHUNK_LEN bytes, si el modulo tiene mas datos se debe volver a llamar (o
+ * usar bg_receive_stream()).
  * 
  * @param connectID numero de conexion en la cual se recibio un mensaje.
- * @param buff puntero a buffer en donde se copiara el mensaje recibido.
- * @param len puntero a variable que almacene el numero de bytes recibidos en el mensaje.
+ * @param buff puntero a buffer en donde se copiara el mensaje recibido (minimo BG_QIRD_CHUNK_LEN bytes).
+ * @param len puntero a variable que almacene el numero de bytes recibidos en el mensaje (0 si no habia datos).
  * @return bg_err_t Regresa el codigo de error basado en el tipo bg_err_t. Si se consigue
  * enviar el mensaje el modulo devuelve BG_OK_RECEIVE.
  */
 bg_err_t bg_receive_buffAMode(uint8_t connectID, uint8_t *buff, uint16_t *len);
 
+/**
+ * @brief Recupera un datagrama de un socket UDP en buffer access mode junto con su direccion de origen
+ * (+QIRD: <len>,"<remoteIP>",<remote_port>).
+ * 
+ * @param connectID numero de conexion.
+ * @param buff puntero a buffer en donde se copiara el datagrama (minimo BG_QIRD_UDP_LEN bytes).
+ * @param len puntero a variable que almacene el numero de bytes del datagrama (0 si no habia datos).
+ * @param from variable donde se guarda la direccion de origen (puede ser NULL).
+ * @return bg_err_t BG_OK_RECEIVE si el comando se completo.
+ */
+bg_err_t bg_receive_udp(uint8_t connectID, uint8_t *buff, uint16_t *len, bg_udpAddr_t *from);
+
+/**
+ * @brief Tipo de dato para crear un puntero a funcion que recibe cada bloque leido por bg_receive_stream().
+ * 
+ * @param connectID numero de conexion de la que se leyo el bloque.
+ * @param data bytes del bloque (solo es valido durante la llamada).
+ * @param len numero de bytes del bloque (1 a BG_QIRD_CHUNK_LEN, en UDP un datagrama de hasta BG_QIRD_UDP_LEN).
+ * @param ctx Es el puntero de contexto que se entrego en bg_receive_stream().
+ */
+typedef void (*bg_recvSink_t)(uint8_t connectID, const uint8_t *data, uint16_t len, void *ctx);
+
+/**
+ * @brief Vacia el buffer de recepcion del modulo de una conexion en buffer access mode. Lee bloques de
+ * BG_QIRD_CHUNK_LEN (BG_QIRD_UDP_LEN en sockets UDP) con AT+QIRD=<connectID>,<len> y entrega cada uno a sink,
+ * hasta que AT+QIRD=<connectID>,0 indica que no quedan bytes sin leer.
+ * 
+ * @param connectID numero de conexion en la cual se recibio un mensaje.
+ * @param sink funcion que recibe cada bloque.
+ * @param ctx puntero que se entrega a sink (puede ser NULL).
+ * @param total variable donde se guarda el numero de bytes leidos (puede ser NULL).
+ * @return bg_err_t BG_OK_RECEIVE si se vacio el buffer o el error del AT+QIRD que fallo (los bloques anteriores
+ * ya se entregaron a sink).
+ */
+bg_err_t bg_receive_stream(uint8_t connectID, bg_recvSink_t sink, void *ctx, uint32_t *total);
+
 /**
  * @brief Transmite datos en modo transparente. 
  * 
- * NOTE: Si no se tiene habilitado el modo transparente no envia nada por UART.
+ * NOTE: Si no se tiene habilitado el modo transparente no envia nada por UART. Se registra el instante del
+ * envio para que bg_exit_transparent_mode() solo espere lo que falte del tiempo de guarda.
  * 
  * @param data Es el puntero al buffer que contiene el mensaje a transmitir. 
  * @param len Es el numero de bytes que se quieren transmitir.
@@ -1137,6 +1915,9 @@ typedef enum
 	BG_URC_PDP_DEACT,
 	BG_URC_EXIT_TM,
 	BG_URC_NO_CARRIER,
+	BG_URC_CEREG,
+	BG_URC_QIOPEN,
+	BG_URC_CPIN,
 	BG_URC_UNSUPPORTED
 }bg_urcType_t;
 
@@ -1157,6 +1938,13 @@ typedef enum
  * 
  * NOTE: El Usuario puede prescindir de ella y realizar su estrategia de manejo de URC en este punto.
  * 
+ * NOTE: urcData.buff es prestado: apunta al renglon dentro del buffer de respuesta de la libreria y solo es valido
+ * durante la llamada (su longitud es urcData.len). Si se quiere guardar el URC se deben copiar los
+ * bytes (ej. con bg_queue_put(), que copia urcData.len bytes a la cola).
+ * 
+ * NOTE: "+QIURC: \"recv\",<connectID>,<len>" de direct push mode no pasa por aqui, sus datos se encolan junto
+ * con el connectID y bg_handle_urc(void) los entrega con bg_urc_parsed_callback().
+ * 
  * @param urcData Es una variable que contiene el buffer de informacion no analizada (o datos crudos) y el tipo de URC detectado.
  */
 void bg_callback_urcDetected(urcRawData_t urcData);
@@ -1223,11 +2011,15 @@ void bg_pdp_activation_callback(uint8_t contextID);
 
 /**
  * @brief Esta funcion de callback notifica al usuario que no hay más URC por atender y se esta fuera de modo transparente.
- * Esta funcion se llama en bg_handle(void) y su proposito es recordar al usuario de que tiene posibilidad de
+ * Esta funcion se llama en bg_handle_urc(void) y su proposito es recordar al usuario de que tiene posibilidad de
  * entrar en modo transparente.
  * 
+ * Solo se llama despues de una salida de modo transparente y con la politica de bg_set_tm_reentry(): el primer intento
+ * espera delayMs sin URC y cada intento que no regresa a TM duplica la espera (hasta maxDelayMs) hasta maxTries
+ * intentos. Despues de una salida por NO CARRIER solo se llama una vez.
+ * 
  * La funcion por defecto de la libreria verifica que la ultima conexion de modo transparente este abierta y si es asi,
- * procede a activar el modo transparente en esa conexion.
+ * procede a activar el modo transparente en esa conexion (despues de NO CARRIER solo lo notifica en el Log).
  * 
  * @param connectID Es el connectID de la ultima conexion en modo transparente.
  * 
@@ -1236,6 +2028,17 @@ void bg_pdp_activation_callback(uint8_t contextID);
  * 
  */
 void bg_callback_TM_Inactive(uint8_t connectID, bg_noCarrierTM_t statusNoCarrier);
+
+/**
+ * @brief Esta funcion de callback notifica al usuario el fin de cada etapa del arranque de red (bg_bringup_step()).
+ * 
+ * La funcion por defecto de la libreria solo imprime la etapa, el resultado y su duracion.
+ * 
+ * @param stage Etapa que termino.
+ * @param err BG_OK si la etapa termino bien o el error con el que fallo.
+ * @param durationMs Duracion de la etapa en ms.
+ */
+void bg_bringup_callback(bg_bringupStage_t stage, bg_err_t err, uint32_t durationMs);
 //---------------------------Callbacks LIB para MCU end------------------------
 
 
@@ -1245,17 +2048,26 @@ void bg_callback_TM_Inactive(uint8_t connectID, bg_noCarrierTM_t statusNoCarrier
  * 
  * NOTE: La libreria usa esta cola cuando se usan los calbacks por defecto de la libreria bg_callback_urcDetected(urcRawData_t urcData, 
  * bg_urc_parsed_callback(urcInfoData_t infoUrc) y la funcion de manejo de URC bg_handle_urc(void).
+ * Solo se copian urc.len bytes de urc.buff (maximo SIZE_URC_BUFF) al arreglo de la cola, si no hay espacio el URC se descarta.
  * @param urc Es la variable que contiene el dato/evento a encolar.
  */
 void bg_queue_put(urcRawData_t urc);
 
 /**
- * @brief Esta funcion hacer uso de la cola interna de URC de la libreria y desencola mensajes del tipo urcRawData_t
+ * @brief Esta funcion hacer uso de la cola interna de URC de la libreria y obtiene el siguiente mensaje del tipo urcRawData_t
+ * sin copiarlo, urc->buff apunta al mensaje dentro de la cola (terminado en '\0').
  * 
- * @param urc Es un puntero a la variable en donde se quiere copiar el mensaje/evento desencolado.
+ * NOTE: El mensaje sigue ocupando la cola hasta llamar a bg_queue_release(), despues de eso urc->buff deja de ser valido.
+ * @param urc Es un puntero a la variable en donde se deja la vista del mensaje/evento.
  */
 void bg_queue_pop(urcRawData_t *urc);
 
+/**
+ * @brief Libera el mensaje obtenido con bg_queue_pop() y su espacio en la cola interna.
+ * 
+ */
+void bg_queue_release(void);
+
 /**
  * @brief Indica si la cola interna esta vacia.
  * 
@@ -35,7 +35,7 @@ void print_queue(qData_t data)
         break;
 
     case T_BG_URC:
-        LOG_QUEUE("\nUrcBuff: %s\nUrcLen:%ld\nUrcType:%d\n", data.data.urc.buff,\
+        LOG_QUEUE("\nUrcBuff: %.*s\nUrcLen:%ld\nUrcType:%d\n", data.data.urc.len, data.data.urc.buff,\
              data.data.urc.len, data.data.urc.type);
         break;
     
@@ -130,3 +130,130 @@ static qData_t frente(Cola_t *cola)
     return cola->elem[cola->front];
 }
 
+
+void create_rec_queue(ColaRec_t *cola, uint8_t *arena, uint16_t size)
+{
+    cola->is_empty = rec_is_empty;
+    cola->is_full = rec_is_full;
+    cola->put = rec_enqueue;
+    cola->peek = rec_peek;
+    cola->release = rec_release;
+
+    cola->arena = arena;
+    cola->size = size;
+    cola->head = cola->tail = cola->count = 0;
+}
+
+static int rec_is_empty(ColaRec_t *cola)
+{
+    return (cola->count == 0) ? 1 : 0;
+}
+
+static int rec_is_full(ColaRec_t *cola)
+{
+    uint16_t need = REC_HDR_SIZE + 1;
+
+    if(cola->count == 0)
+        return (cola->size < need) ? 1 : 0;
+
+    if(cola->head == cola->tail)
+        return 1;
+
+    if(cola->head > cola->tail)
+        return (cola->size - cola->head < need && cola->tail < need) ? 1 : 0;
+
+    return (cola->tail - cola->head < need) ? 1 : 0;
+}
+
+static int rec_enqueue(ColaRec_t *cola, uint8_t type, const uint8_t *data, uint16_t len)
+{
+    uint32_t need = REC_HDR_SIZE + (uint32_t)len + 1;
+
+    if(cola->count == 0)
+        cola->head = cola->tail = 0;
+
+    if(need > cola->size || (cola->count > 0 && cola->head == cola->tail))
+    {
+        LOG_QUEUE("The queue is full\n");
+        return -1;
+    }
+
+    if(cola->head >= cola->tail)
+    {
+        if((uint32_t)(cola->size - cola->head) < need)
+        {
+            //the record does not fit at the end, it is written at the start of the arena
+            if(cola->tail < need && cola->count > 0)
+            {
+                LOG_QUEUE("The queue is full\n");
+                return -1;
+            }
+
+            if(cola->size - cola->head >= REC_HDR_SIZE)
+            {
+                cola->arena[cola->head] = REC_WRAP_MARK & 0xFF;
+                cola->arena[cola->head + 1] = REC_WRAP_MARK >> 8;
+            }
+
+            cola->head = 0;
+        }
+    }
+
+    else if((uint32_t)(cola->tail - cola->head) < need)
+    {
+        LOG_QUEUE("The queue is full\n");
+        return -1;
+    }
+
+    uint8_t *rec = &cola->arena[cola->head];
+    rec[0] = len & 0xFF;
+    rec[1] = len >> 8;
+    rec[2] = type;
+    memcpy(&rec[REC_HDR_SIZE], data, len);
+    rec[REC_HDR_SIZE + len] = '\0';
+
+    cola->head += need;
+    if(cola->head == cola->size)
+        cola->head = 0;
+
+    cola->count++;
+
+    LOG_QUEUE("Inserting record: %.*s\n", len, data);
+    return 0;
+}
+
+static int rec_peek(ColaRec_t *cola, urcRawData_t *rec)
+{
+    if(cola->count == 0)
+    {
+        LOG_QUEUE("The queue is empty\n");
+        return 0;
+    }
+
+    //skips the unused tail of the arena when the record was written at the start
+    if(cola->size - cola->tail < REC_HDR_SIZE || \
+        (cola->arena[cola->tail] | (cola->arena[cola->tail + 1] << 8)) == REC_WRAP_MARK)
+        cola->tail = 0;
+
+    uint8_t *hdr = &cola->arena[cola->tail];
+    rec->len = hdr[0] | (hdr[1] << 8);
+    rec->type = hdr[2];
+    rec->buff = &hdr[REC_HDR_SIZE];
+
+    return 1;
+}
+
+static void rec_release(ColaRec_t *cola)
+{
+    urcRawData_t rec;
+
+    if(!rec_peek(cola, &rec))
+        return;
+
+    cola->tail += REC_HDR_SIZE + rec.len + 1;
+    if(cola->tail == cola->size)
+        cola->tail = 0;
+
+    if(--cola->count == 0)
+        cola->head = cola->tail = 0;
+}
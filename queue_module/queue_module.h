@@ -78,11 +78,23 @@
 #define SIZE_STR 10 
 
 /**
- * @brief This MACRO is the size of the URC buffer 
+ * @brief This MACRO is the max size of an URC record (payload bytes)
  * 
  */
 #define SIZE_URC_BUFF 1024
 
+/**
+ * @brief This MACRO is the size of the header of each record in a record queue (2 bytes length + 1 byte type)
+ * 
+ */
+#define REC_HDR_SIZE 3
+
+/**
+ * @brief This MACRO is the length value that marks the unused tail of the arena when a record wraps to the start
+ * 
+ */
+#define REC_WRAP_MARK 0xFFFF
+
 /** 
  * @brief This is the types enum definition for identify each item of the queue
  */
@@ -99,8 +111,12 @@ typedef enum
     T_UNSUPPORTED
 }typeData_t;
 
+/**
+ * @brief This is a view of an URC (or any variable length record). It does not own the bytes, buff points
+ * to the record data (for instance, inside the arena of a record queue)
+ */
 typedef struct{
-    uint8_t buff[SIZE_URC_BUFF];
+    uint8_t *buff;
     uint16_t len;
     uint8_t type;
 }urcRawData_t;
@@ -243,6 +259,117 @@ struct Cola {
     tf3_t peek;
 };
 
+/**
+ * @brief This is the record queue typedef. It is a FIFO of variable length records stored in a byte arena,
+ * each record takes only REC_HDR_SIZE + its length + 1 (null terminator) bytes
+ * 
+ */
+typedef struct ColaRec ColaRec_t;
+
+/**
+ * @brief This is the definition for a function pointer with ColaRec_t parameter and return of int type
+ * 
+ */
+typedef int(* tr0_t)(ColaRec_t *cola);
+
+/**
+ * @brief This is the definition for a function pointer to put a record (type, data, len) into a ColaRec_t
+ * 
+ */
+typedef int(* tr1_t)(ColaRec_t *cola, uint8_t type, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief This is the definition for a function pointer to get a view of the next record of a ColaRec_t
+ * 
+ */
+typedef int(* tr2_t)(ColaRec_t *cola, urcRawData_t *rec);
+
+/**
+ * @brief This is the definition for a function pointer with ColaRec_t parameter and return of void type
+ * 
+ */
+typedef void(* tr3_t)(ColaRec_t *cola);
+
+/**
+ * @brief This is the record queue structure definition
+ * 
+ */
+struct ColaRec {
+
+    /**
+     * @brief byte arena where the records are stored (given by the user)
+     * 
+     */
+    uint8_t *arena;
+
+    /**
+     * @brief size in bytes of the arena
+     * 
+     */
+    uint16_t size;
+
+    /**
+     * @brief offset of the next record to write
+     * 
+     */
+    uint16_t head;
+
+    /**
+     * @brief offset of the next record to read
+     * 
+     */
+    uint16_t tail;
+
+    /**
+     * @brief number of records in the queue
+     * 
+     */
+    uint16_t count;
+
+    /**
+     * @brief Checks if the queue is empty
+     * 
+     * @param cola The queue instance
+     * @return int if the queue is empty returns 1 otherwise returns 0
+     */
+    tr0_t is_empty;
+
+    /**
+     * @brief Checks if the queue is full (there is no room even for an empty record)
+     * 
+     * @param cola The queue instance
+     * @return int if the queue is full returns 1 otherwise returns 0
+     */
+    tr0_t is_full;
+
+    /**
+     * @brief Copies a new record into the arena
+     * 
+     * @param cola queue instance
+     * @param type record type
+     * @param data record bytes
+     * @param len number of bytes of the record
+     * @return int if there is no room for the record returns -1 otherwise returns 0
+     */
+    tr1_t put;
+
+    /**
+     * @brief Gets a view (in place, without copying) of the next record. The view is valid until release is called
+     * 
+     * @param cola queue instance
+     * @param rec view of the record (buff points inside the arena and it is null terminated)
+     * @return int if the queue is empty returns 0 otherwise returns 1
+     */
+    tr2_t peek;
+
+    /**
+     * @brief Releases the next record (the one returned by peek) and frees its bytes
+     * 
+     * @param cola queue instance
+     */
+    tr3_t release;
+};
+
 /**
  * @brief Initializes the attributes of the queue instance
  * 
@@ -304,4 +431,56 @@ void create_queue(Cola_t *cola);
  */
 void print_queue(qData_t data);
 
+/**
+ * @brief Checks if the record queue is empty
+ * 
+ * @param cola The queue instance
+ * @return int if the queue is empty returns 1 otherwise returns 0
+ */
+static int rec_is_empty(ColaRec_t *cola);
+
+/**
+ * @brief Checks if the record queue is full
+ * 
+ * @param cola The queue instance
+ * @return int if the queue is full returns 1 otherwise returns 0
+ */
+static int rec_is_full(ColaRec_t *cola);
+
+/**
+ * @brief Copies a new record into the arena of the record queue
+ * 
+ * @param cola queue instance
+ * @param type record type
+ * @param data record bytes
+ * @param len number of bytes of the record
+ * @return int if there is no room for the record returns -1 otherwise returns 0
+ */
+static int rec_enqueue(ColaRec_t *cola, uint8_t type, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Gets a view of the next record of the record queue without copying it
+ * 
+ * @param cola queue instance
+ * @param rec view of the record
+ * @return int if the queue is empty returns 0 otherwise returns 1
+ */
+static int rec_peek(ColaRec_t *cola, urcRawData_t *rec);
+
+/**
+ * @brief Releases the next record of the record queue
+ * 
+ * @param cola queue instance
+ */
+static void rec_release(ColaRec_t *cola);
+
+/**
+ * @brief This is the constructor of the record queue. It initializes the methods pointers and the queue attributes
+ * 
+ * @param cola queue instance
+ * @param arena byte array where the records will be stored
+ * @param size size in bytes of the arena
+ */
+void create_rec_queue(ColaRec_t *cola, uint8_t *arena, uint16_t size);
+
 #endif // QUEUE_MODULE_H